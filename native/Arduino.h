@@ -0,0 +1,194 @@
+#pragma once
+
+// The subset of the Arduino core the firmware uses, running on the virtual clock of Host.cpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "avr/io.h"
+#include "avr/pgmspace.h"
+#include "avr/interrupt.h"
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+using byte = uint8_t;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+// avr-libc's generator, so a seed gives the same sequence as on the board
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+class __FlashStringHelper;
+#define F(str) (reinterpret_cast<const __FlashStringHelper*>(str))
+
+class Print
+{
+    size_t printNumber(unsigned long number, uint8_t base)
+    {
+        char buffer[8 * sizeof(long) + 1];
+        char* str = &buffer[sizeof(buffer) - 1];
+        *str = '\0';
+
+        if(base < 2)
+        {
+            base = 10;
+        }
+
+        do
+        {
+            const char digit = number % base;
+            number /= base;
+            *--str = digit < 10 ? digit + '0' : digit + 'A' - 10;
+        } while(number);
+
+        return print(str);
+    }
+
+public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t byte) = 0;
+
+    virtual size_t write(const uint8_t* buffer, size_t size)
+    {
+        size_t count = 0;
+        while(size--)
+        {
+            count += write(*buffer++);
+        }
+
+        return count;
+    }
+
+    size_t print(const char* str)
+    {
+        return write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+    }
+
+    size_t print(const __FlashStringHelper* str)
+    {
+        return print(reinterpret_cast<const char*>(str));
+    }
+
+    size_t print(char c)
+    {
+        return write(static_cast<uint8_t>(c));
+    }
+
+    size_t print(unsigned long number, int base = DEC)
+    {
+        return printNumber(number, base);
+    }
+
+    size_t print(long number, int base = DEC)
+    {
+        if(base == DEC && number < 0)
+        {
+            return print('-') + printNumber(-static_cast<unsigned long>(number), base);
+        }
+
+        return printNumber(number, base);
+    }
+
+    size_t print(unsigned char number, int base = DEC)
+    {
+        return print(static_cast<unsigned long>(number), base);
+    }
+
+    size_t print(unsigned int number, int base = DEC)
+    {
+        return print(static_cast<unsigned long>(number), base);
+    }
+
+    size_t print(int number, int base = DEC)
+    {
+        return print(static_cast<long>(number), base);
+    }
+
+    size_t print(unsigned short number, int base = DEC)
+    {
+        return print(static_cast<unsigned long>(number), base);
+    }
+
+    size_t print(short number, int base = DEC)
+    {
+        return print(static_cast<long>(number), base);
+    }
+
+    size_t println()
+    {
+        return print('\n');
+    }
+
+    template<typename T>
+    size_t println(T value)
+    {
+        return print(value) + println();
+    }
+
+    template<typename T>
+    size_t println(T value, int base)
+    {
+        return print(value, base) + println();
+    }
+};
+
+// Goes to stdout
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long)
+    {
+    }
+
+    void flush()
+    {
+    }
+
+    int available()
+    {
+        return 0;
+    }
+
+    int read()
+    {
+        return -1;
+    }
+
+    size_t write(uint8_t byte) override;
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+void setup();
+void loop();
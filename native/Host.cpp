@@ -0,0 +1,792 @@
+#include "Host.hpp"
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+
+HardwareSerial Serial;
+
+// Only there so the RAM report links, the values mean nothing on the host.
+// __data_start and __bss_start come with the host toolchain.
+extern "C"
+{
+    uint8_t __data_end;
+    uint8_t __bss_end;
+    uint8_t __heap_start;
+    char* __brkval = nullptr;
+}
+
+namespace Host
+{
+    uint8_t eeprom[E2END + 1];
+
+    namespace
+    {
+        uint64_t nanos = 0;
+
+        void advanceNanos(uint64_t amount)
+        {
+            nanos += amount;
+        }
+
+        struct EepromInit
+        {
+            EepromInit()
+            {
+                memset(eeprom, 0xFF, sizeof(eeprom));
+            }
+        } eepromInit;
+    }
+
+    uint64_t getMicros()
+    {
+        return nanos / 1000;
+    }
+
+    void advance(uint32_t micros)
+    {
+        advanceNanos(static_cast<uint64_t>(micros) * 1000);
+    }
+
+    namespace Bus
+    {
+        namespace
+        {
+            enum class Target : uint8_t
+            {
+                None,
+                Mux,
+                Display,
+                Unknown
+            };
+
+            enum class DisplayMode : uint8_t
+            {
+                Control,
+                Commands,
+                SingleCommand,
+                Data
+            };
+
+            struct Window
+            {
+                uint8_t columnStart = 0;
+                uint8_t columnEnd = width - 1;
+                uint8_t pageStart = 0;
+                uint8_t pageEnd = height / 8 - 1;
+
+                uint8_t column = 0;
+                uint8_t page = 0;
+            };
+
+            Screen screens[screenCount];
+            Window windows[screenCount];
+            Stats stats;
+
+            Target target = Target::None;
+            bool expectAddress = false;
+            uint8_t channels = 0;
+
+            DisplayMode mode = DisplayMode::Control;
+            uint8_t command = 0;
+            uint8_t arguments[6] = {};
+            uint8_t argumentCount = 0;
+            uint8_t argumentsNeeded = 0;
+
+            // 9 bits per byte with the ack, SCL = F_CPU / (16 + 2 * TWBR)
+            uint64_t getByteNanos()
+            {
+                return 9 * (16 + 2 * static_cast<uint64_t>(TWBR)) * 1000 / (F_CPU / 1000000);
+            }
+
+            uint8_t getArgumentCount(uint8_t code)
+            {
+                switch(code)
+                {
+                    case 0x21: // COLUMNADDR
+                    case 0x22: // PAGEADDR
+                    case 0xA3: // SET_VERTICAL_SCROLL_AREA
+                        return 2;
+                    case 0x29:
+                    case 0x2A:
+                        return 5;
+                    case 0x26:
+                    case 0x27:
+                        return 6;
+                    case 0x20: // MEMORYMODE
+                    case 0x81: // SETCONTRAST
+                    case 0x8D: // CHARGEPUMP
+                    case 0xA8: // SETMULTIPLEX
+                    case 0xD3: // SETDISPLAYOFFSET
+                    case 0xD5: // SETDISPLAYCLOCKDIV
+                    case 0xD9: // SETPRECHARGE
+                    case 0xDA: // SETCOMPINS
+                    case 0xDB: // SETVCOMDETECT
+                        return 1;
+                    default:
+                        return 0;
+                }
+            }
+
+            template<typename Function>
+            void forSelected(Function function)
+            {
+                for(uint8_t x = 0; x < screenCount; x++)
+                {
+                    if(channels & (1 << (firstChannel + x)))
+                    {
+                        function(screens[x], windows[x]);
+                    }
+                }
+            }
+
+            void runCommand()
+            {
+                forSelected([](Screen& screen, Window& window)
+                {
+                    if(command == 0x21)
+                    {
+                        window.columnStart = arguments[0] % width;
+                        window.columnEnd = arguments[1] % width;
+                        window.column = window.columnStart;
+                    }
+                    else if(command == 0x22)
+                    {
+                        window.pageStart = arguments[0] % (height / 8);
+                        window.pageEnd = arguments[1] % (height / 8);
+                        window.page = window.pageStart;
+                    }
+                    else if(command == 0xAE)
+                    {
+                        screen.on = false;
+                    }
+                    else if(command == 0xAF)
+                    {
+                        screen.on = true;
+                    }
+                });
+            }
+
+            void onCommandByte(uint8_t byte)
+            {
+                stats.commandBytes++;
+
+                if(argumentsNeeded == 0)
+                {
+                    command = byte;
+                    argumentCount = 0;
+                    argumentsNeeded = getArgumentCount(byte);
+                }
+                else
+                {
+                    arguments[argumentCount++] = byte;
+                    argumentsNeeded--;
+                }
+
+                if(argumentsNeeded == 0)
+                {
+                    runCommand();
+                }
+            }
+
+            // Horizontal addressing, the pointer wraps inside the window
+            void onDataByte(uint8_t byte)
+            {
+                stats.dataBytes++;
+
+                forSelected([byte](Screen& screen, Window& window)
+                {
+                    screen.pages[window.page][window.column] = byte;
+
+                    if(window.column == window.columnEnd)
+                    {
+                        window.column = window.columnStart;
+                        window.page = window.page == window.pageEnd ? window.pageStart : window.page + 1;
+                    }
+                    else
+                    {
+                        window.column = (window.column + 1) % width;
+                    }
+                });
+            }
+
+            void onDisplayByte(uint8_t byte)
+            {
+                if(mode == DisplayMode::Control)
+                {
+                    stats.commandBytes++;
+
+                    // Co bit set: a single byte follows, then another control byte
+                    if(byte & 0x40)
+                    {
+                        mode = DisplayMode::Data;
+                    }
+                    else
+                    {
+                        mode = byte & 0x80 ? DisplayMode::SingleCommand : DisplayMode::Commands;
+                    }
+                }
+                else if(mode == DisplayMode::Data)
+                {
+                    onDataByte(byte);
+                }
+                else
+                {
+                    onCommandByte(byte);
+
+                    if(mode == DisplayMode::SingleCommand)
+                    {
+                        mode = DisplayMode::Control;
+                    }
+                }
+            }
+
+            void onByte(uint8_t byte)
+            {
+                stats.bytes++;
+                advanceNanos(getByteNanos());
+
+                if(expectAddress)
+                {
+                    expectAddress = false;
+
+                    const uint8_t address = byte >> 1;
+                    if(address == muxAddress)
+                    {
+                        target = Target::Mux;
+                    }
+                    else if(address == displayAddress)
+                    {
+                        target = Target::Display;
+                        mode = DisplayMode::Control;
+                    }
+                    else
+                    {
+                        target = Target::Unknown;
+                    }
+
+                    return;
+                }
+
+                if(target == Target::Mux)
+                {
+                    stats.muxBytes++;
+                    channels = byte;
+                }
+                else if(target == Target::Display)
+                {
+                    onDisplayByte(byte);
+                }
+                else
+                {
+                    stats.unknownBytes++;
+                }
+            }
+        }
+
+        uint32_t getByteMicros()
+        {
+            return getByteNanos() / 1000;
+        }
+
+        const Screen& getScreen(uint8_t index)
+        {
+            return screens[index];
+        }
+
+        const Stats& getStats()
+        {
+            return stats;
+        }
+
+        void resetStats()
+        {
+            stats = {};
+        }
+
+        void onStart()
+        {
+            stats.starts++;
+            expectAddress = true;
+            argumentsNeeded = 0;
+            advanceNanos(getByteNanos() / 9);
+        }
+
+        void onStop()
+        {
+            target = Target::None;
+            advanceNanos(getByteNanos() / 9);
+        }
+
+        void onByteWritten(uint8_t byte)
+        {
+            const auto before = nanos;
+            onByte(byte);
+            stats.busyMicros += (nanos - before) / 1000;
+        }
+    }
+
+    // Transfers complete instantly in firmware terms, TWINT reads back set
+    void writeTwiControl(uint8_t value)
+    {
+        if(value & _BV(TWSTA))
+        {
+            Bus::onStart();
+            TWSR = 0x08;
+        }
+        else if(value & _BV(TWSTO))
+        {
+            Bus::onStop();
+            value &= ~_BV(TWSTO);
+        }
+        else if((value & _BV(TWINT)) && (value & _BV(TWEN)))
+        {
+            Bus::onByteWritten(TWDR);
+            TWSR = 0x28;
+        }
+        else
+        {
+            TWCR.value = value;
+            return;
+        }
+
+        TWCR.value = value | _BV(TWINT);
+    }
+
+    namespace Buttons
+    {
+        namespace
+        {
+            uint8_t handles = 0;
+            uint8_t menu = 0;
+            uint16_t zaps[handleCount] = {};
+
+            struct Output
+            {
+                Register<uint8_t>& port;
+                uint8_t mask;
+            };
+
+            // Same order as Input::zap
+            Output outputs[handleCount] =
+            {
+                {PORTD, 1 << 7},
+                {PORTB, 1 << 1},
+                {PORTB, 1 << 3},
+                {PORTD, 1 << 5},
+            };
+        }
+
+        void setHandle(uint8_t index, bool pressed)
+        {
+            handles = pressed ? handles | (1 << index) : handles & ~(1 << index);
+        }
+
+        void setMenu(uint8_t index, bool pressed)
+        {
+            menu = pressed ? menu | (1 << index) : menu & ~(1 << index);
+        }
+
+        uint16_t getZaps(uint8_t index)
+        {
+            return zaps[index];
+        }
+
+        void onDelay()
+        {
+            for(uint8_t x = 0; x < handleCount; x++)
+            {
+                if(outputs[x].port & outputs[x].mask)
+                {
+                    zaps[x]++;
+                }
+            }
+        }
+
+        uint8_t read(Port port)
+        {
+            // Inputs read their pull-up, outputs what they drive
+            if(port == Port::B)
+            {
+                uint8_t pins = PORTB & ~(_BV(0) | _BV(2) | _BV(4));
+                pins |= (handles & 1) | (handles & 2) << 1 | (handles & 4) << 2;
+                return pins;
+            }
+            else if(port == Port::C)
+            {
+                // Menu buttons pull PC1-PC3 low, the sound module's BUSY output PC0 while it plays
+                uint8_t pins = PORTC & ~(menu << 1);
+                if(Sound::getState().playing)
+                {
+                    pins &= ~_BV(0);
+                }
+                return pins;
+            }
+
+            uint8_t pins = PORTD & ~_BV(6);
+            pins |= (handles & 8) << 3;
+            return pins;
+        }
+    }
+
+    uint8_t readPins(Port port)
+    {
+        return Buttons::read(port);
+    }
+
+    namespace Leds
+    {
+        namespace
+        {
+            Pixel pixels[maxCount];
+            uint8_t index = 0;
+            uint64_t lastByte = 0;
+            uint32_t shows = 0;
+        }
+
+        void write(uint8_t byte)
+        {
+            if(nanos - lastByte > 50000 || shows == 0)
+            {
+                index = 0;
+                shows++;
+            }
+
+            if(index < maxCount * 3)
+            {
+                auto& pixel = pixels[index / 3];
+                uint8_t* channels[] = {&pixel.g, &pixel.r, &pixel.b};
+                *channels[index % 3] = byte;
+                index++;
+            }
+
+            // 8 bits of 1.25us
+            advanceNanos(10000);
+            lastByte = nanos;
+        }
+
+        const Pixel& getPixel(uint8_t index)
+        {
+            return pixels[index];
+        }
+
+        uint32_t getShows()
+        {
+            return shows;
+        }
+    }
+
+    namespace Sound
+    {
+        namespace
+        {
+            static constexpr uint8_t frameSize = 10;
+            static constexpr uint8_t bufferSize = 32;
+
+            State state;
+
+            uint64_t txEnd = 0;
+            uint8_t frame[frameSize] = {};
+            uint8_t frameUsed = 0;
+            bool booted = false;
+
+            struct Pending
+            {
+                uint64_t due;
+                uint8_t byte;
+            };
+
+            Pending replies[64] = {};
+            uint8_t replyCount = 0;
+
+            uint16_t checksum(const uint8_t* bytes)
+            {
+                uint16_t sum = 0;
+                for(uint8_t x = 1; x < 7; x++)
+                {
+                    sum += bytes[x];
+                }
+
+                return -sum;
+            }
+
+            // Bytes go out back to back after anything already scheduled
+            void reply(uint64_t at, uint8_t command, uint16_t param)
+            {
+                uint8_t bytes[frameSize] = {0x7E, 0xFF, 0x06, command, 0, static_cast<uint8_t>(param >> 8), static_cast<uint8_t>(param)};
+                const auto sum = checksum(bytes);
+                bytes[7] = sum >> 8;
+                bytes[8] = sum;
+                bytes[9] = 0xEF;
+
+                if(replyCount && replies[replyCount - 1].due > at)
+                {
+                    at = replies[replyCount - 1].due;
+                }
+
+                for(uint8_t x = 0; x < frameSize && replyCount < sizeof(replies) / sizeof(replies[0]); x++)
+                {
+                    at += byteMicros * 1000ULL;
+                    replies[replyCount++] = {at, bytes[x]};
+                }
+            }
+
+            void boot()
+            {
+                if(!booted)
+                {
+                    booted = true;
+                    reply(bootMillis * 1000000ULL, 0x3F, 0x02);
+                }
+            }
+
+            void onFrame(uint64_t at)
+            {
+                if(frame[1] != 0xFF || frame[2] != 0x06 || frame[9] != 0xEF)
+                {
+                    return;
+                }
+
+                if(((static_cast<uint16_t>(frame[7]) << 8) | frame[8]) != checksum(frame))
+                {
+                    return;
+                }
+
+                // Still booting, the module doesn't listen yet
+                if(at < bootMillis * 1000000ULL)
+                {
+                    return;
+                }
+
+                state.frames++;
+
+                const uint8_t command = frame[3];
+                const uint16_t param = (static_cast<uint16_t>(frame[5]) << 8) | frame[6];
+
+                switch(command)
+                {
+                    case 0x03:
+                        state.track = param;
+                        state.playing = true;
+                        break;
+                    case 0x06:
+                        state.volume = param;
+                        break;
+                    case 0x0C:
+                        state = {};
+                        reply(at + bootMillis * 1000000ULL, 0x3F, 0x02);
+                        return;
+                    case 0x0D:
+                        state.playing = state.track != 0;
+                        break;
+                    case 0x0E:
+                        state.playing = false;
+                        break;
+                    case 0x16:
+                        state.track = 0;
+                        state.playing = false;
+                        break;
+                    case 0x19:
+                        state.looping = param == 0;
+                        break;
+                    case 0x42:
+                        reply(at + ackMillis * 1000000ULL, 0x42, state.playing);
+                        break;
+                }
+
+                if(frame[4])
+                {
+                    reply(at + ackMillis * 1000000ULL, 0x41, 0);
+                }
+            }
+        }
+
+        bool write(const uint8_t* data, uint8_t count)
+        {
+            boot();
+
+            const auto start = txEnd > nanos ? txEnd : nanos;
+            const uint64_t queued = (start - nanos) / (byteMicros * 1000ULL);
+            if(queued + count > bufferSize - 1)
+            {
+                return false;
+            }
+
+            txEnd = start;
+            for(uint8_t x = 0; x < count; x++)
+            {
+                txEnd += byteMicros * 1000ULL;
+
+                if(frameUsed == 0 && data[x] != 0x7E)
+                {
+                    continue;
+                }
+
+                frame[frameUsed++] = data[x];
+                if(frameUsed == frameSize)
+                {
+                    frameUsed = 0;
+                    onFrame(txEnd);
+                }
+            }
+
+            return true;
+        }
+
+        bool isSending()
+        {
+            return nanos < txEnd;
+        }
+
+        bool isReceiving()
+        {
+            return replyCount && replies[0].due - byteMicros * 1000ULL <= nanos;
+        }
+
+        uint8_t available()
+        {
+            boot();
+
+            uint8_t count = 0;
+            while(count < replyCount && replies[count].due <= nanos)
+            {
+                count++;
+            }
+
+            return count;
+        }
+
+        uint8_t read()
+        {
+            if(!available())
+            {
+                return 0;
+            }
+
+            const auto byte = replies[0].byte;
+            replyCount--;
+            memmove(replies, replies + 1, replyCount * sizeof(replies[0]));
+            return byte;
+        }
+
+        const State& getState()
+        {
+            return state;
+        }
+    }
+
+    namespace
+    {
+        uint32_t analogState = 1;
+        unsigned long randomState = 1;
+    }
+
+    void setAnalogSeed(uint32_t seed)
+    {
+        analogState = seed ? seed : 1;
+    }
+}
+
+void eeprom_read_block(void* destination, const void* address, size_t size)
+{
+    memcpy(destination, Host::eeprom + reinterpret_cast<uintptr_t>(address), size);
+}
+
+void eeprom_update_block(const void* source, void* address, size_t size)
+{
+    memcpy(Host::eeprom + reinterpret_cast<uintptr_t>(address), source, size);
+}
+
+size_t HardwareSerial::write(uint8_t byte)
+{
+    return fputc(byte, stdout) == EOF ? 0 : 1;
+}
+
+unsigned long millis()
+{
+    return Host::getMicros() / 1000;
+}
+
+unsigned long micros()
+{
+    return Host::getMicros();
+}
+
+void delay(unsigned long ms)
+{
+    Host::Buttons::onDelay();
+    Host::advance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    Host::advance(us);
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t, uint8_t)
+{
+}
+
+int digitalRead(uint8_t)
+{
+    return LOW;
+}
+
+// Floating input noise, xorshift32
+int analogRead(uint8_t)
+{
+    auto& x = Host::analogState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x & 0x3FF;
+}
+
+// avr-libc random(): Park-Miller minimal standard, Schrage's method
+long random(long howBig)
+{
+    if(howBig == 0)
+    {
+        return 0;
+    }
+
+    long x = Host::randomState;
+    if(x == 0)
+    {
+        x = 123459876L;
+    }
+
+    const long hi = x / 127773L;
+    const long lo = x % 127773L;
+    x = 16807L * lo - 2836L * hi;
+    if(x < 0)
+    {
+        x += 0x7FFFFFFFL;
+    }
+
+    Host::randomState = x;
+    return (x % 0x80000000UL) % howBig;
+}
+
+long random(long howSmall, long howBig)
+{
+    if(howSmall >= howBig)
+    {
+        return howSmall;
+    }
+
+    return random(howBig - howSmall) + howSmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+    if(seed != 0)
+    {
+        Host::randomState = seed;
+    }
+}
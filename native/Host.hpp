@@ -0,0 +1,116 @@
+#pragma once
+
+// Emulated board for the native build. Time only moves when the firmware waits or talks to a
+// peripheral: delay(), bytes on the I2C bus, LED pixels and sound module frames each cost what
+// they would on the board, the rest of the CPU time is free.
+
+#include <stdint.h>
+
+namespace Host
+{
+    uint64_t getMicros();
+    void advance(uint32_t micros);
+
+    // TCA9548A mux at 0x70 in front of SSD1306 displays at 0x3C, one per mux channel
+    namespace Bus
+    {
+        static constexpr uint8_t muxAddress = 0x70;
+        static constexpr uint8_t displayAddress = 0x3C;
+
+        static constexpr uint8_t firstChannel = 3;
+        static constexpr uint8_t screenCount = 5;
+
+        static constexpr uint8_t width = 128;
+        static constexpr uint8_t height = 64;
+
+        struct Screen
+        {
+            uint8_t pages[height / 8][width] = {};
+            bool on = false;
+
+            bool getPixel(uint8_t x, uint8_t y) const
+            {
+                return pages[y / 8][x] & (1 << (y % 8));
+            }
+        };
+
+        struct Stats
+        {
+            uint32_t starts = 0;
+            uint32_t bytes = 0;
+            uint32_t muxBytes = 0;
+            uint32_t commandBytes = 0;
+            uint32_t dataBytes = 0;
+            uint32_t unknownBytes = 0;
+            uint64_t busyMicros = 0;
+        };
+
+        // Screens by mux channel, from channel 3: player 1, player 3, player 2, player 4, menu
+        const Screen& getScreen(uint8_t index);
+        const Stats& getStats();
+        void resetStats();
+
+        // Cost of one byte with its ack at the rate set in TWBR
+        uint32_t getByteMicros();
+    }
+
+    // Handles 0-3 and the up/select/down menu buttons
+    namespace Buttons
+    {
+        static constexpr uint8_t handleCount = 4;
+        static constexpr uint8_t menuCount = 3;
+
+        void setHandle(uint8_t index, bool pressed);
+        void setMenu(uint8_t index, bool pressed);
+
+        // Zaps delivered per handle, counted when a handle output is high during a delay()
+        uint16_t getZaps(uint8_t index);
+    }
+
+    namespace Leds
+    {
+        static constexpr uint8_t maxCount = 16;
+
+        struct Pixel
+        {
+            uint8_t r = 0;
+            uint8_t g = 0;
+            uint8_t b = 0;
+        };
+
+        // One byte of GRB data on the strip, pixels latch after a 50us gap
+        void write(uint8_t byte);
+
+        const Pixel& getPixel(uint8_t index);
+        uint32_t getShows();
+    }
+
+    // DFPlayer on the software serial: acks commands and reports its own boot
+    namespace Sound
+    {
+        static constexpr uint32_t byteMicros = 1000000 * 10 / 9600;
+        static constexpr uint32_t bootMillis = 600;
+        static constexpr uint32_t ackMillis = 20;
+
+        struct State
+        {
+            uint16_t track = 0;
+            uint8_t volume = 0;
+            bool playing = false;
+            bool looping = false;
+            uint32_t frames = 0;
+        };
+
+        // Queues bytes from the board, returns false when the buffer is full
+        bool write(const uint8_t* data, uint8_t count);
+        bool isSending();
+        bool isReceiving();
+
+        uint8_t available();
+        uint8_t read();
+
+        const State& getState();
+    }
+
+    void setAnalogSeed(uint32_t seed);
+}
@@ -0,0 +1,210 @@
+#include "Session.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Arduino.h>
+
+#include "Host.hpp"
+
+namespace Session
+{
+    namespace
+    {
+        constexpr const char* menuButtons = "usd";
+
+        void setButton(char button, bool pressed)
+        {
+            if(button >= '0' && button < '0' + Host::Buttons::handleCount)
+            {
+                Host::Buttons::setHandle(button - '0', pressed);
+            }
+            else if(const char* menu = strchr(menuButtons, button))
+            {
+                Host::Buttons::setMenu(menu - menuButtons, pressed);
+            }
+        }
+
+        bool isNumber(const char* token)
+        {
+            return *token && strspn(token, "0123456789") == strlen(token);
+        }
+    }
+
+    bool isButton(char button)
+    {
+        return (button >= '0' && button < '0' + Host::Buttons::handleCount) || (button && strchr(menuButtons, button));
+    }
+
+    uint8_t parse(Script& script, int count, const char* const* tokens)
+    {
+        const char* token = tokens[0];
+
+        if(strcmp(token, "--seed") == 0 && count > 1 && isNumber(tokens[1]))
+        {
+            script.seed = strtoul(tokens[1], nullptr, 10);
+            return 2;
+        }
+
+        if(strcmp(token, "--max-frame-us") == 0 && count > 1 && isNumber(tokens[1]))
+        {
+            script.maxFrameMicros = strtoul(tokens[1], nullptr, 10);
+            return 2;
+        }
+
+        if(strcmp(token, "--max-frame-bytes") == 0 && count > 1 && isNumber(tokens[1]))
+        {
+            script.maxFrameBytes = strtoul(tokens[1], nullptr, 10);
+            return 2;
+        }
+
+        if(isNumber(token))
+        {
+            script.duration = strtoul(token, nullptr, 10) * 1000;
+            return 1;
+        }
+
+        char* end = nullptr;
+        const auto at = strtoul(token, &end, 10);
+        if(end == token || end[0] != ':' || !isButton(end[1]) || script.pressCount == maxPresses)
+        {
+            return 0;
+        }
+
+        uint16_t duration = defaultPress;
+        if(end[2] == ':' && isNumber(end + 3))
+        {
+            duration = strtoul(end + 3, nullptr, 10);
+        }
+        else if(end[2] != '\0')
+        {
+            return 0;
+        }
+
+        script.presses[script.pressCount++] = {static_cast<uint32_t>(at), end[1], duration};
+        return 1;
+    }
+
+    bool load(Script& script, const char* path)
+    {
+        FILE* file = fopen(path, "r");
+        if(!file)
+        {
+            fprintf(stderr, "can't open %s\n", path);
+            return false;
+        }
+
+        char line[256];
+        bool valid = true;
+
+        while(fgets(line, sizeof(line), file) && valid)
+        {
+            if(char* comment = strchr(line, '#'))
+            {
+                *comment = '\0';
+            }
+
+            const char* tokens[8];
+            int count = 0;
+            for(char* token = strtok(line, " \t\r\n"); token && count < 8; token = strtok(nullptr, " \t\r\n"))
+            {
+                tokens[count++] = token;
+            }
+
+            for(int x = 0; x < count && valid; )
+            {
+                const auto used = parse(script, count - x, tokens + x);
+                if(used == 0)
+                {
+                    fprintf(stderr, "%s: can't parse %s\n", path, tokens[x]);
+                    valid = false;
+                }
+                x += used;
+            }
+        }
+
+        fclose(file);
+        return valid;
+    }
+
+    void save(const Script& script, FILE* file)
+    {
+        fprintf(file, "%u\n--seed %u\n", script.duration / 1000, script.seed);
+
+        for(uint8_t x = 0; x < script.pressCount; x++)
+        {
+            const auto& press = script.presses[x];
+            fprintf(file, "%u:%c:%u\n", press.at, press.button, press.duration);
+        }
+    }
+
+    bool check(const Script& script, const Result& result)
+    {
+        bool passed = true;
+
+        if(script.maxFrameMicros && result.longestFrame > script.maxFrameMicros)
+        {
+            fprintf(stderr, "frame of %uus at %ums, bound %uus\n", result.longestFrame, result.longestFrameAt, script.maxFrameMicros);
+            passed = false;
+        }
+
+        if(script.maxFrameBytes && result.mostFrameBytes > script.maxFrameBytes)
+        {
+            fprintf(stderr, "frame of %u bus bytes at %ums, bound %u\n", result.mostFrameBytes, result.mostFrameBytesAt, script.maxFrameBytes);
+            passed = false;
+        }
+
+        return passed;
+    }
+
+    Result run(const Script& script)
+    {
+        Result result;
+
+        Host::setAnalogSeed(script.seed);
+        setup();
+
+        while(millis() < script.duration)
+        {
+            // Releases first, a button can be pressed more than once in the script
+            const auto now = millis();
+            for(uint8_t x = 0; x < script.pressCount; x++)
+            {
+                setButton(script.presses[x].button, false);
+            }
+            for(uint8_t x = 0; x < script.pressCount; x++)
+            {
+                const auto& press = script.presses[x];
+                if(now >= press.at && now < press.at + press.duration)
+                {
+                    setButton(press.button, true);
+                }
+            }
+
+            const auto start = Host::getMicros();
+            const auto bytes = Host::Bus::getStats().bytes;
+
+            loop();
+
+            const uint32_t frameMicros = Host::getMicros() - start;
+            const uint32_t frameBytes = Host::Bus::getStats().bytes - bytes;
+
+            result.frames++;
+            if(frameMicros > result.longestFrame)
+            {
+                result.longestFrame = frameMicros;
+                result.longestFrameAt = now;
+            }
+            if(frameBytes > result.mostFrameBytes)
+            {
+                result.mostFrameBytes = frameBytes;
+                result.mostFrameBytesAt = now;
+            }
+
+            Host::advance(loopMicros);
+        }
+
+        result.busBytes = Host::Bus::getStats().bytes;
+        return result;
+    }
+}
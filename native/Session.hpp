@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// A scripted run of the firmware on the virtual clock. Scripts are the arguments of the native
+// program, on the command line or one or more per line in a file (# starts a comment):
+//   seconds              how long to run, 10 by default
+//   at:button[:ms]       presses a button at a time in ms, for 100ms by default. Buttons are 0-3
+//                        for the handles and u, s, d for the menu
+//   --seed N             seed of the analog noise Random::init reads
+//   --max-frame-us N     fails the run when a frame takes longer than N us
+//   --max-frame-bytes N  fails the run when a frame sends more than N bus bytes
+namespace Session
+{
+    static constexpr uint8_t maxPresses = 96;
+    static constexpr uint16_t defaultPress = 100;
+
+    // Fixed cost of one pass through loop(), the CPU time itself isn't modelled
+    static constexpr uint32_t loopMicros = 100;
+
+    struct Press
+    {
+        uint32_t at;
+        char button;
+        uint16_t duration;
+    };
+
+    struct Script
+    {
+        uint32_t duration = 10000;
+        uint32_t seed = 1;
+
+        // 0 when unbounded
+        uint32_t maxFrameMicros = 0;
+        uint32_t maxFrameBytes = 0;
+        uint8_t pressCount = 0;
+        Press presses[maxPresses] = {};
+    };
+
+    // A frame is one pass through loop(), its time is what the bus, the LEDs and delay() cost
+    struct Result
+    {
+        uint32_t frames = 0;
+        uint64_t busBytes = 0;
+
+        uint32_t longestFrame = 0;
+        uint32_t longestFrameAt = 0;
+
+        uint32_t mostFrameBytes = 0;
+        uint32_t mostFrameBytesAt = 0;
+    };
+
+    // Takes the option at tokens[0], returns how many tokens it used or 0 when it isn't one
+    uint8_t parse(Script& script, int count, const char* const* tokens);
+    bool load(Script& script, const char* path);
+    void save(const Script& script, FILE* file);
+
+    bool isButton(char button);
+
+    // Prints what went over the script's bounds, false when something did
+    bool check(const Script& script, const Result& result);
+
+    // Calls setup() then loop() until the script ends, only once per process
+    Result run(const Script& script);
+}
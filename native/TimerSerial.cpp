@@ -0,0 +1,34 @@
+#include "../src/TimerSerial.hpp"
+
+#include "Host.hpp"
+
+// Replaces src/TimerSerial.cpp in the native build, the bytes go to the emulated sound module
+
+void TimerSerial::begin()
+{
+}
+
+bool TimerSerial::write(const uint8_t* data, uint8_t count)
+{
+    return Host::Sound::write(data, count);
+}
+
+uint8_t TimerSerial::available()
+{
+    return Host::Sound::available();
+}
+
+uint8_t TimerSerial::read()
+{
+    return Host::Sound::read();
+}
+
+bool TimerSerial::isIdle()
+{
+    return !Host::Sound::isSending() && !Host::Sound::isReceiving();
+}
+
+bool TimerSerial::isSending()
+{
+    return Host::Sound::isSending();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// EEPROM addresses are plain offsets into Host::eeprom, erased cells read 0xFF
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "avr/io.h"
+
+namespace Host
+{
+    extern uint8_t eeprom[E2END + 1];
+}
+
+void eeprom_read_block(void* destination, const void* address, size_t size);
+void eeprom_update_block(const void* source, void* address, size_t size);
+
+inline uint8_t eeprom_read_byte(const uint8_t* address)
+{
+    uint8_t value;
+    eeprom_read_block(&value, address, sizeof(value));
+    return value;
+}
+
+inline uint16_t eeprom_read_word(const uint16_t* address)
+{
+    uint16_t value;
+    eeprom_read_block(&value, address, sizeof(value));
+    return value;
+}
+
+inline uint32_t eeprom_read_dword(const uint32_t* address)
+{
+    uint32_t value;
+    eeprom_read_block(&value, address, sizeof(value));
+    return value;
+}
+
+inline void eeprom_update_byte(uint8_t* address, uint8_t value)
+{
+    eeprom_update_block(&value, address, sizeof(value));
+}
+
+inline void eeprom_update_word(uint16_t* address, uint16_t value)
+{
+    eeprom_update_block(&value, address, sizeof(value));
+}
+
+inline void eeprom_update_dword(uint32_t* address, uint32_t value)
+{
+    eeprom_update_block(&value, address, sizeof(value));
+}
+
+inline void eeprom_write_byte(uint8_t* address, uint8_t value)
+{
+    eeprom_update_byte(address, value);
+}
+
+inline void eeprom_write_word(uint16_t* address, uint16_t value)
+{
+    eeprom_update_word(address, value);
+}
+
+inline void eeprom_write_dword(uint32_t* address, uint32_t value)
+{
+    eeprom_update_dword(address, value);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Nothing preempts the host build, vectors are plain functions nobody calls
+
+#define ISR(vector, ...) extern "C" void vector(void)
+
+inline void cli()
+{
+}
+
+inline void sei()
+{
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+// Host stand-in for the ATmega328p registers the firmware touches.
+// Plain registers only hold their value. The pin registers read the emulated buttons and
+// writing TWCR runs the transfer on the emulated bus, see Host.cpp.
+
+#include <stdint.h>
+
+namespace Host
+{
+    template<typename T>
+    struct Register
+    {
+        T value = 0;
+
+        operator T() const
+        {
+            return value;
+        }
+
+        Register& operator=(T other)
+        {
+            value = other;
+            return *this;
+        }
+
+        Register& operator|=(T other)
+        {
+            value |= other;
+            return *this;
+        }
+
+        Register& operator&=(T other)
+        {
+            value &= other;
+            return *this;
+        }
+
+        Register& operator^=(T other)
+        {
+            value ^= other;
+            return *this;
+        }
+
+        Register& operator+=(T other)
+        {
+            value += other;
+            return *this;
+        }
+
+        Register& operator-=(T other)
+        {
+            value -= other;
+            return *this;
+        }
+    };
+
+    enum class Port : uint8_t
+    {
+        B,
+        C,
+        D
+    };
+
+    uint8_t readPins(Port port);
+    void writeTwiControl(uint8_t value);
+
+    struct PinRegister
+    {
+        Port port;
+
+        operator uint8_t() const
+        {
+            return readPins(port);
+        }
+    };
+
+    struct TwiControlRegister : Register<uint8_t>
+    {
+        TwiControlRegister& operator=(uint8_t other)
+        {
+            writeTwiControl(other);
+            return *this;
+        }
+    };
+}
+
+inline Host::Register<uint8_t> PORTB, PORTC, PORTD;
+inline Host::Register<uint8_t> DDRB, DDRC, DDRD;
+inline const Host::PinRegister PINB{Host::Port::B}, PINC{Host::Port::C}, PIND{Host::Port::D};
+
+inline Host::Register<uint8_t> SREG;
+// No stack to measure, the RAM report reads it as full
+inline uint16_t SP = 0;
+
+inline Host::Register<uint8_t> TWBR, TWSR, TWDR;
+inline Host::TwiControlRegister TWCR;
+
+inline Host::Register<uint8_t> TCCR1A, TCCR1B, TIMSK1, TIFR1;
+inline Host::Register<uint16_t> TCNT1;
+
+inline Host::Register<uint8_t> TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+inline Host::Register<uint8_t> EICRA, EIMSK, EIFR;
+
+#define _BV(bit) (1 << (bit))
+#define _SFR_BYTE(sfr) (sfr)
+
+#define RAMEND 0x8FF
+#define E2END 0x3FF
+
+#define TWINT 7
+#define TWEA 6
+#define TWSTA 5
+#define TWSTO 4
+#define TWWC 3
+#define TWEN 2
+#define TWIE 0
+#define TWPS1 1
+#define TWPS0 0
+
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define TOIE1 0
+#define TOV1 0
+
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define OCIE2A 1
+#define OCIE2B 2
+#define OCF2A 1
+#define OCF2B 2
+
+#define ISC10 2
+#define ISC11 3
+#define INT1 1
+#define INTF1 1
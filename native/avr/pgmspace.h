@@ -0,0 +1,57 @@
+#pragma once
+
+// Flash and RAM share one address space on the host, PROGMEM data is read in place
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(str) (str)
+#define PGM_P const char*
+
+inline uint8_t pgm_read_byte(const void* address)
+{
+    return *static_cast<const uint8_t*>(address);
+}
+
+inline uint16_t pgm_read_word(const void* address)
+{
+    uint16_t value;
+    memcpy(&value, address, sizeof(value));
+    return value;
+}
+
+inline uint32_t pgm_read_dword(const void* address)
+{
+    uint32_t value;
+    memcpy(&value, address, sizeof(value));
+    return value;
+}
+
+inline const void* pgm_read_ptr(const void* address)
+{
+    const void* value;
+    memcpy(&value, address, sizeof(value));
+    return value;
+}
+
+inline void* memcpy_P(void* destination, const void* source, size_t size)
+{
+    return memcpy(destination, source, size);
+}
+
+inline size_t strlen_P(const char* str)
+{
+    return strlen(str);
+}
+
+inline char* strcpy_P(char* destination, const char* source)
+{
+    return strcpy(destination, source);
+}
+
+inline int strcmp_P(const char* a, const char* b)
+{
+    return strcmp(a, b);
+}
@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+
+#include "Host.hpp"
+#include "Session.hpp"
+#include "Statistics.hpp"
+#include "Sounds.hpp"
+
+// Runs the firmware on the virtual clock and reports what reached the peripherals.
+//
+//   program [script...] [--script file] [--screens] [--eeprom file] [--expect-plays N]
+//   program --sound-queue
+//
+// The script arguments are described in Session.hpp, --script reads more of them from a file
+// like the ones tools/fuzz saves. The worst ones found so far are kept with their bounds in
+// tools/fuzz/scenarios, each must pass:
+//   for f in tools/fuzz/scenarios/*.txt; do program --script $f > /dev/null || echo $f; done
+//
+// --screens prints the five framebuffers at the end. --eeprom loads the EEPROM from a raw image,
+// like one read from the board, and writes it back at the end.
+// --expect-plays fails the run unless the lifetime statistics counted exactly N more games.
+// --sound-queue runs a sound controller on its own instead of the firmware and checks that
+// commands pushed faster than the module acks them still leave it in the last requested state.
+
+namespace
+{
+    // A missing image leaves the EEPROM erased, it is created at the end
+    void loadEeprom(const char* path)
+    {
+        if(FILE* file = fopen(path, "rb"))
+        {
+            fread(Host::eeprom, 1, sizeof(Host::eeprom), file);
+            fclose(file);
+        }
+    }
+
+    void saveEeprom(const char* path)
+    {
+        if(FILE* file = fopen(path, "wb"))
+        {
+            fwrite(Host::eeprom, 1, sizeof(Host::eeprom), file);
+            fclose(file);
+        }
+    }
+
+    // Lifetime plays of all games, 0 while the statistics were never written
+    uint32_t countPlays()
+    {
+        if(eeprom_read_byte(&Statistics::stored().version) != Statistics::version)
+        {
+            return 0;
+        }
+
+        uint32_t plays = 0;
+        for(uint8_t x = 0; x < GameCount; x++)
+        {
+            plays += Statistics::getPlays(x);
+        }
+        return plays;
+    }
+
+    // Runs the controller until the module answered everything queued, false if it never does
+    bool settleSound(SoundController& sound)
+    {
+        const auto until = millis() + 5000;
+        while(millis() < until)
+        {
+            sound.update();
+            if(sound.isReady() && sound.getQueueDepth() == 0)
+            {
+                return true;
+            }
+
+            Host::advance(Session::loopMicros);
+        }
+
+        return false;
+    }
+
+    bool expectSound(const char* name, uint16_t track, bool playing)
+    {
+        const auto& state = Host::Sound::getState();
+        if(state.track == track && state.playing == playing)
+        {
+            return true;
+        }
+
+        fprintf(stderr, "%s: expected track %u %s, module has track %u %s\n", name, track, playing ? "playing" : "stopped",
+            state.track, state.playing ? "playing" : "stopped");
+        return false;
+    }
+
+    bool checkSoundQueue()
+    {
+        SoundController sound;
+        sound.init();
+        if(!settleSound(sound))
+        {
+            fprintf(stderr, "sound module never answered\n");
+            return false;
+        }
+
+        // A pause between two plays must not outlive the second one
+        sound.play(Song::Menu);
+        sound.pause();
+        sound.play(Song::Pong);
+        if(!settleSound(sound) || !expectSound("play pause play", static_cast<uint8_t>(Song::Pong), true))
+        {
+            return false;
+        }
+
+        // Same with the first play already on the wire
+        sound.play(Song::Voting);
+        sound.update();
+        sound.pause();
+        sound.play(Song::Intro);
+        if(!settleSound(sound) || !expectSound("sent play pause play", static_cast<uint8_t>(Song::Intro), true))
+        {
+            return false;
+        }
+
+        sound.play(Song::Menu);
+        sound.pause();
+        sound.stop();
+        if(!settleSound(sound) || !expectSound("play pause stop", 0, false))
+        {
+            return false;
+        }
+
+        printf("sound queue ok, %u commands coalesced\n", sound.getStats().coalesced);
+        return true;
+    }
+
+    void printScreens()
+    {
+        static constexpr const char* names[Host::Bus::screenCount] = {"player 1", "player 3", "player 2", "player 4", "menu"};
+
+        for(uint8_t x = 0; x < Host::Bus::screenCount; x++)
+        {
+            const auto& screen = Host::Bus::getScreen(x);
+            printf("%s%s\n", names[x], screen.on ? "" : " (off)");
+
+            for(uint8_t y = 0; y < Host::Bus::height; y++)
+            {
+                char line[Host::Bus::width + 1] = {};
+                for(uint8_t column = 0; column < Host::Bus::width; column++)
+                {
+                    line[column] = screen.getPixel(column, y) ? '#' : '.';
+                }
+                puts(line);
+            }
+        }
+    }
+
+    void printReport(const Session::Result& result)
+    {
+        const auto elapsed = millis();
+        const auto& bus = Host::Bus::getStats();
+
+        printf("time %lums\n", elapsed);
+        printf("i2c starts %u bytes %u (mux %u, commands %u, data %u, unknown %u) busy %llums %.1f%%\n",
+            bus.starts, bus.bytes, bus.muxBytes, bus.commandBytes, bus.dataBytes, bus.unknownBytes,
+            static_cast<unsigned long long>(bus.busyMicros / 1000), elapsed ? bus.busyMicros / 10.0 / elapsed : 0.0);
+
+        printf("frames %u, longest %uus at %ums, most bytes %u at %ums\n", result.frames,
+            result.longestFrame, result.longestFrameAt, result.mostFrameBytes, result.mostFrameBytesAt);
+
+        printf("leds shows %u:", Host::Leds::getShows());
+        for(uint8_t x = 0; x < Host::Leds::maxCount; x++)
+        {
+            const auto& pixel = Host::Leds::getPixel(x);
+            printf(" %02X%02X%02X", pixel.r, pixel.g, pixel.b);
+        }
+        printf("\n");
+
+        const auto& sound = Host::Sound::getState();
+        printf("sound frames %u track %u volume %u %s%s\n", sound.frames, sound.track, sound.volume,
+            sound.playing ? "playing" : "stopped", sound.looping ? " looping" : "");
+
+        printf("zaps");
+        for(uint8_t x = 0; x < Host::Buttons::handleCount; x++)
+        {
+            printf(" %u", Host::Buttons::getZaps(x));
+        }
+        printf("\n");
+
+        printf("plays");
+        for(uint8_t x = 0; x < GameCount; x++)
+        {
+            printf(" %u", Statistics::getPlays(x));
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Session::Script script;
+    bool screens = false;
+    const char* eeprom = nullptr;
+    long expectedPlays = -1;
+
+    for(int x = 1; x < argc; x++)
+    {
+        const char* arg = argv[x];
+
+        if(strcmp(arg, "--sound-queue") == 0)
+        {
+            return checkSoundQueue() ? 0 : 1;
+        }
+        else if(strcmp(arg, "--screens") == 0)
+        {
+            screens = true;
+        }
+        else if(strcmp(arg, "--eeprom") == 0 && x + 1 < argc)
+        {
+            eeprom = argv[++x];
+        }
+        else if(strcmp(arg, "--expect-plays") == 0 && x + 1 < argc)
+        {
+            expectedPlays = strtol(argv[++x], nullptr, 10);
+        }
+        else if(strcmp(arg, "--script") == 0 && x + 1 < argc)
+        {
+            if(!Session::load(script, argv[++x]))
+            {
+                return 2;
+            }
+        }
+        else if(const auto used = Session::parse(script, argc - x, argv + x))
+        {
+            x += used - 1;
+        }
+        else
+        {
+            fprintf(stderr, "can't parse %s\n", arg);
+            return 2;
+        }
+    }
+
+    if(eeprom)
+    {
+        loadEeprom(eeprom);
+    }
+
+    const auto playsBefore = countPlays();
+    const auto result = Session::run(script);
+    const auto plays = countPlays() - playsBefore;
+
+    fflush(stdout);
+
+    if(eeprom)
+    {
+        saveEeprom(eeprom);
+    }
+
+    printReport(result);
+
+    if(screens)
+    {
+        printScreens();
+    }
+
+    if(expectedPlays >= 0 && plays != static_cast<uint32_t>(expectedPlays))
+    {
+        fprintf(stderr, "expected %ld plays, counted %u\n", expectedPlays, plays);
+        return 1;
+    }
+
+    if(!Session::check(script, result))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+
+#define ATOMIC_BLOCK(type) for(bool atomicOnce = true; atomicOnce; atomicOnce = false)
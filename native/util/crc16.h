@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+// Same results as the avr-libc versions
+
+inline uint16_t _crc16_update(uint16_t crc, uint8_t data)
+{
+    crc ^= data;
+    for(uint8_t x = 0; x < 8; x++)
+    {
+        crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+
+    return crc;
+}
+
+inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+{
+    crc ^= data;
+    for(uint8_t x = 0; x < 8; x++)
+    {
+        crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+
+    return crc;
+}
@@ -0,0 +1,157 @@
+"""Generates src/SoundManifest.hpp from the MP3s in resources/audio.
+
+Files must be named like the DFPlayer expects them on the SD card, "NN_Name.mp3",
+where NN is the track number. Durations are computed by walking the MPEG frames.
+
+Runs as a PlatformIO pre script (see platformio.ini) or standalone:
+    python scripts/generate_sound_manifest.py
+"""
+
+import os
+import re
+import sys
+
+BITRATES = {
+    # (version is MPEG1, layer) -> kbps table
+    (True, 1): [0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448],
+    (True, 2): [0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384],
+    (True, 3): [0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320],
+    (False, 1): [0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256],
+    (False, 2): [0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160],
+    (False, 3): [0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160],
+}
+
+SAMPLE_RATES = {
+    3: [44100, 48000, 32000],  # MPEG1
+    2: [22050, 24000, 16000],  # MPEG2
+    0: [11025, 12000, 8000],   # MPEG2.5
+}
+
+
+def skip_id3(data):
+    if data[:3] != b"ID3":
+        return 0
+
+    size = 0
+    for byte in data[6:10]:
+        size = (size << 7) | (byte & 0x7F)
+
+    footer = 10 if data[5] & 0x10 else 0
+    return 10 + size + footer
+
+
+def parse_header(data, offset):
+    if offset + 4 > len(data):
+        return None
+
+    b0, b1, b2, _ = data[offset:offset + 4]
+    if b0 != 0xFF or (b1 & 0xE0) != 0xE0:
+        return None
+
+    version = (b1 >> 3) & 0x03
+    layer = 4 - ((b1 >> 1) & 0x03)
+    bitrate_index = b2 >> 4
+    rate_index = (b2 >> 2) & 0x03
+    padding = (b2 >> 1) & 0x01
+
+    if version == 1 or layer == 4 or bitrate_index in (0, 15) or rate_index == 3:
+        return None
+
+    mpeg1 = version == 3
+    bitrate = BITRATES[(mpeg1, layer)][bitrate_index] * 1000
+    sample_rate = SAMPLE_RATES[version][rate_index]
+
+    if layer == 1:
+        samples = 384
+        length = (12 * bitrate // sample_rate + padding) * 4
+    else:
+        samples = 1152 if (layer == 2 or mpeg1) else 576
+        length = samples // 8 * bitrate // sample_rate + padding
+
+    return length, samples, sample_rate
+
+
+def duration_ms(path):
+    with open(path, "rb") as file:
+        data = file.read()
+
+    offset = skip_id3(data)
+    total = 0.0
+
+    while offset < len(data):
+        header = parse_header(data, offset)
+        if header is None:
+            offset += 1
+            continue
+
+        length, samples, sample_rate = header
+        total += samples / sample_rate
+        offset += length
+
+    return int(round(total * 1000))
+
+
+def generate(project_dir):
+    audio_dir = os.path.join(project_dir, "resources", "audio")
+    output = os.path.join(project_dir, "src", "SoundManifest.hpp")
+
+    tracks = []
+    for name in sorted(os.listdir(audio_dir)):
+        match = re.match(r"^(\d+)_(.+)\.mp3$", name, re.IGNORECASE)
+        if not match:
+            continue
+
+        number = int(match.group(1))
+        duration = duration_ms(os.path.join(audio_dir, name))
+        tracks.append((number, duration, name))
+
+    lines = [
+        "#pragma once",
+        "",
+        "// Generated by scripts/generate_sound_manifest.py from resources/audio, do not edit",
+        "",
+        "#include <stdint.h>",
+        "#include \"avr/pgmspace.h\"",
+        "",
+        "struct TrackInfo",
+        "{",
+        "    uint8_t track;",
+        "    uint32_t duration;",
+        "};",
+        "",
+        "namespace SoundManifest",
+        "{",
+        "    PROGMEM constexpr TrackInfo tracks[] =",
+        "    {",
+    ]
+
+    for number, duration, name in tracks:
+        lines.append("        {%d, %d}, // %s" % (number, duration, name))
+
+    lines += [
+        "    };",
+        "",
+        "    constexpr uint8_t trackCount = sizeof(tracks) / sizeof(tracks[0]);",
+        "}",
+        "",
+    ]
+
+    content = "\n".join(lines)
+
+    if os.path.exists(output):
+        with open(output, "r") as file:
+            if file.read() == content:
+                return
+
+    with open(output, "w", newline="\n") as file:
+        file.write(content)
+
+    print("Generated %s (%d tracks)" % (os.path.relpath(output, project_dir), len(tracks)))
+
+
+try:
+    Import("env")  # noqa: F821
+    generate(env["PROJECT_DIR"])  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        generate(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
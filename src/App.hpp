@@ -9,12 +9,18 @@
 #include "DisplayBuffer.hpp"
 #include "input.hpp"
 #include "LedController.hpp"
-#include "menu.hpp"
+#include "Menu.hpp"
 #include "SettingDisplay.hpp"
 #include "Games.hpp"
 #include "glyphs.hpp"
 #include "debug.hpp"
 #include "Sounds.hpp"
+#include "Statistics.hpp"
+#include "Profiler.hpp"
+#include "BootProfiler.hpp"
+#include "Memory.hpp"
+#include "Replay.hpp"
+#include "Random.hpp"
 
 class App
 {
@@ -24,6 +30,7 @@ public:
     Joining,
     Menu,
     Setting,
+    Statistics,
     Paused,
     Game,
 
@@ -40,10 +47,18 @@ private:
   GameRunner gameRunner;
   SoundController soundController;
 
-  Phase phase;
+  // Count until init sets the first phase, there is nothing to leave then
+  Phase phase = Phase::Count;
   
+  // Frames only run once at least one tick elapsed. After a long blocking frame at most
+  // maxTicks are simulated, the rest of the backlog is dropped rather than replayed in a burst.
+  static constexpr uint8_t maxTicks = 16;
+  static_assert(maxTicks * GameState::tickTime <= UINT8_MAX);
+
   uint32_t lastFrame = {};
-  uint8_t deltaTime = {};
+  uint8_t ticks = {};
+
+  uint32_t lastReport = {};
 
   using PhaseFunction = void (App::*)(void);
   struct PhaseFunctions
@@ -55,9 +70,10 @@ private:
 
   PhaseFunctions phaseFunctions[static_cast<uint8_t>(Phase::Count)] = 
   {
-    {.onStart=&App::onJoining, .onIdle=&App::updateJoining},
+    {.onStart=&App::onJoining, .onIdle=&App::updateJoining, .onEnd=&App::endJoining},
     {.onStart=&App::onMenu, .onIdle=&App::updateMenu},
     {.onIdle=&App::updateSetting},
+    {.onStart=&App::onStatistics, .onIdle=&App::updateStatistics},
     {.onStart=&App::onPaused, .onIdle=&App::updatePaused},
     {.onIdle=&App::updateGame},
   };
@@ -73,10 +89,31 @@ private:
   uint8_t selectedGame = -1;
   GameState::Difficulty selectedDifficulty{};
 
+  static constexpr PROGMEM LedAnimation::Keyframe attractKeys[] =
+  {
+    {0, 0xFF0000},
+    {400, 0xFFFF00},
+    {800, 0x00FF00},
+    {1200, 0x00FFFF},
+    {1600, 0x0000FF},
+    {2000, 0xFF00FF},
+    {2400, 0xFF0000},
+  };
+  static constexpr PROGMEM auto attract = LedAnimation::makeTrack(attractKeys, true, 240);
+
+  static constexpr PROGMEM LedAnimation::Keyframe joinKeys[] =
+  {
+    {0, 0xFFFFFF},
+    {300, 0x000000},
+  };
+  static constexpr PROGMEM auto joinFlash = LedAnimation::makeTrack(joinKeys);
+
   void onJoining()
   {
     soundController.play(Song::Intro);
 
+    ledController.play(LedController::Layer::Ambient, attract);
+
     auto& state = gameRunner.state;
     for(uint8_t x = 0; x < state.maxPlayerCount; x++)
     {
@@ -91,12 +128,19 @@ private:
   {
     auto& state = gameRunner.state;
 
+    // Nothing draws from Random before the first game, the seed keeps improving until then
+    Random::stir(analogRead(A6));
+
     for(uint8_t x = 0; x < state.maxPlayerCount; x++)
     {
       if (!state.isPlayerPresent(x) && input.isNewPressed(input.buttonFromIndex(x)))
       {
+        Random::stir(micros());
+
         state.playerJoin(x);
 
+        ledController.play(LedController::Layer::Flash, joinFlash, LedController::AllLeds, LedAnimation::Blend::Add);
+
         display.selectScreenfromIndex(x);
         display.clearRect(0, 4 * 8, Display::Width, 8);
         display.printP("You are player "_PSTR);
@@ -126,6 +170,13 @@ private:
     }
   }
 
+  void endJoining()
+  {
+    ledController.stop(LedController::Layer::Ambient);
+
+    replay.seed();
+  }
+
   void onMenu()
   {
     soundController.play(Song::Menu);
@@ -157,6 +208,14 @@ private:
           gameType = GameType::Continious;
           startRandomGame();
         }
+        else if(action == MenuAction::ResetTuning)
+        {
+          Tuning::reset();
+        }
+        else if(action == MenuAction::ShowStatistics)
+        {
+          setPhase(Phase::Statistics);
+        }
         else if(action == MenuAction::DemoZaps)
         {
           for(uint8_t x = 0; x < 4; x++)
@@ -181,6 +240,11 @@ private:
         setPhase(Phase::Setting);
         settingDisplay.setSetting(static_cast<SettingId>(entry->getParam()));
       }
+      else if(type == EntryType::Parameter)
+      {
+        setPhase(Phase::Setting);
+        settingDisplay.setTuning(static_cast<TuningId>(entry->getParam()));
+      }
     }
   }
 
@@ -189,7 +253,79 @@ private:
     if(settingDisplay.update(display, input, ledController))
     {
       setPhase(Phase::Menu);
-      menu.setMenu(Menus::Settings);
+      menu.setMenu(settingDisplay.isTuning() ? Menus::Parameters : Menus::Settings);
+    }
+  }
+
+  void onStatistics()
+  {
+    if constexpr (debug::statistics)
+    {
+      Statistics::dump(Serial);
+    }
+
+    if constexpr (debug::memory)
+    {
+      dumpModuleSizes(Serial);
+    }
+
+    display.selectMenu();
+    display.printP("Statistics"_PSTR);
+
+    constexpr uint8_t valueColumn = 90;
+
+    uint8_t line = 1;
+    for(uint8_t x = 0; x < GameCount; x++, line++)
+    {
+      display.startDraw(0, line * 8, valueColumn, 8);
+      display.printP(readPgm(gameDefinitions[x]).title);
+
+      display.startDraw(valueColumn, line * 8, Display::Width - valueColumn, 8);
+      display.print_UL(Statistics::getPlays(x));
+    }
+
+    display.startDraw(0, line * 8, Display::Width, 8);
+    display.printP("Zaps"_PSTR);
+    for(uint8_t x = 0; x < GameState::maxPlayerCount; x++)
+    {
+      display.printSpace();
+      display.print('A' + x);
+      display.print_UL(Statistics::getZaps(x));
+    }
+    line++;
+
+    display.startDraw(0, line * 8, Display::Width, 8);
+    display.printP("Vote avg "_PSTR);
+    display.print_UL(Statistics::getAverageVoting() / 1000);
+    display.print('s');
+    line++;
+
+    static constexpr PROGMEM char difficultyLetters[Statistics::difficultyCount] = {'E', 'N', 'H'};
+
+    display.startDraw(0, line * 8, Display::Width, 8);
+    display.printP("React"_PSTR);
+    for(uint8_t x = 0; x < Statistics::difficultyCount; x++)
+    {
+      display.printSpace();
+      display.print(readPgm(difficultyLetters[x]));
+
+      const auto median = Statistics::getMedianReaction(x);
+      if(median < 0)
+      {
+        display.print('-');
+      }
+      else
+      {
+        display.print_UL(median);
+      }
+    }
+  }
+
+  void updateStatistics()
+  {
+    if(input.isNewPressed(Input::Button::MenuButtons))
+    {
+      setPhase(Phase::Menu);
     }
   }
 
@@ -206,18 +342,15 @@ private:
     setPhase(Phase::Game);
     gameType = GameType::Continious;
     
-    const auto previousGame = selectedGame;
-    do
-    {
-      selectedGame = random(0, GameCount);
-    } while (selectedGame == previousGame);
+    // Any game but the last one
+    selectedGame = selectedGame < GameCount ? (selectedGame + 1 + Random::below(GameCount - 1)) % GameCount : Random::below(GameCount);
   
     gameRunner.setGame(selectedGame);
   }
 
   void updateGame()
   {
-    gameRunner.update(deltaTime, display, input, ledController, soundController);
+    gameRunner.update(ticks, display, input, ledController, soundController);
 
     if(input.isNewPressed(Input::Button::MenuButtons))
     {
@@ -226,6 +359,9 @@ private:
 
     if(gameRunner.state.phase == GameState::Phase::Finished)
     {
+      // Only seen once, the game is replaced in this same frame
+      Statistics::recordGame(gameRunner.state);
+
       if(gameType == GameType::Continious)
       {
         startRandomGame();
@@ -271,25 +407,114 @@ private:
     }
   }
 
+  void dumpModuleSizes(Print& out)
+  {
+    Memory::printEntry(out, "app"_PSTR, sizeof(App));
+    Memory::printEntry(out, "leds"_PSTR, sizeof(ledController));
+    Memory::printEntry(out, "display"_PSTR, sizeof(display));
+    Memory::printEntry(out, "input"_PSTR, sizeof(input));
+    Memory::printEntry(out, "menu"_PSTR, sizeof(menu));
+    Memory::printEntry(out, "setting"_PSTR, sizeof(settingDisplay));
+    Memory::printEntry(out, "game"_PSTR, sizeof(gameRunner));
+    Memory::printEntry(out, " pong"_PSTR, sizeof(Pong::Data));
+    Memory::printEntry(out, " reaction"_PSTR, sizeof(Reaction::Data));
+    Memory::printEntry(out, " voting"_PSTR, sizeof(Voting::Data));
+    Memory::printEntry(out, "sound"_PSTR, sizeof(soundController));
+    Memory::printEntry(out, "profiler"_PSTR, sizeof(profiler));
+  }
+
+  void drawMemory()
+  {
+    display.selectMenu();
+    display.clearRect(0, 5 * 8, Display::Width, 8);
+
+    display.startDraw(0, 5 * 8, Display::Width, 8);
+    display.printP("RAM "_PSTR);
+    display.print_UL(Memory::getStaticSize());
+    display.printP(" free "_PSTR);
+    display.print_UL(Memory::getFreeMin());
+  }
+
+  void report(uint32_t now)
+  {
+    if(now - lastReport < debug::reportDelay)
+    {
+      return;
+    }
+
+    lastReport = now;
+
+    if constexpr (debug::soundLatency)
+    {
+      soundController.dumpLatency(Serial);
+    }
+
+    if constexpr (debug::memory)
+    {
+      if(phase == Phase::Game)
+      {
+        drawMemory();
+      }
+
+      Memory::dump(Serial);
+    }
+
+    if constexpr (debug::profiler)
+    {
+      if(phase == Phase::Game)
+      {
+        profiler.drawOverlay(display);
+      }
+
+      profiler.dump(Serial);
+    }
+  }
+
 public:
 
   void init()
   {
-    const auto seed = Random::init();
+    if constexpr (debug::serial)
+    {
+      Serial.begin(debug::serialBaud);
+    }
+
+    profiler.init();
+
+    // The DFPlayer takes a while to answer, probe it before anything else
+    soundController.init();
+
+    Random::init();
+    replay.begin();
+
+    loadSettings();
+    Tuning::init();
+    Statistics::init();
+    bootProfiler.mark(BootStep::Storage);
+
+    if constexpr (debug::statistics)
+    {
+      Statistics::dump(Serial);
+    }
+
+    if constexpr (debug::memory)
+    {
+      dumpModuleSizes(Serial);
+    }
 
     SI2C.init(true);
     
     display.selectScreen(Display::Screen::All);
     display.init();
-    display.clearRect();
+    bootProfiler.mark(BootStep::Displays);
 
     input.init();
 
     ledController.init();
 
-    soundController.init();
-
+    // Clears the displays
     setPhase(App::Phase::Joining);
+    bootProfiler.mark(BootStep::JoinScreen);
 
     if constexpr(debug::fastPath)
     {
@@ -311,15 +536,20 @@ public:
 
   void setPhase(Phase newPhase)
   {
-    if(const auto onEnd = phaseFunctions[static_cast<uint8_t>(phase)].onEnd)
+    if(phase != Phase::Count)
     {
-      (this->*onEnd)();
+      if(const auto onEnd = phaseFunctions[static_cast<uint8_t>(phase)].onEnd)
+      {
+        (this->*onEnd)();
+      }
     }
   
     phase = newPhase;
+    replay.flush();
 
     display.selectScreen(Display::Screen::All);
     display.clearRect();
+    gameRunner.state.redraw = true;
 
     ledController.clear();
 
@@ -332,17 +562,71 @@ public:
   void update()
   {
     const auto now = millis();
-    deltaTime = now - lastFrame;
-    lastFrame = now;
 
-    input.update();
-    soundController.update();
+    const uint32_t elapsedTicks = (now - lastFrame) / GameState::tickTime;
+    if(elapsedTicks == 0)
+    {
+      soundController.update();
+      ledController.display();
+      return;
+    }
+
+    if(elapsedTicks > maxTicks)
+    {
+      ticks = maxTicks;
+      lastFrame = now;
+    }
+    else
+    {
+      ticks = elapsedTicks;
+      lastFrame += elapsedTicks * GameState::tickTime;
+    }
+
+    runFrame(now);
+  }
+
+  // Kept out of line so tools/bench can tell where a frame starts and ends
+  [[gnu::noinline]] void runFrame(uint32_t now)
+  {
+    profiler.beginFrame();
+
+    {
+      ProfileScope zone(ProfileZone::Input);
+      input.update();
+      replay.frame(ticks, input);
+    }
+
+    {
+      ProfileScope zone(ProfileZone::Sound);
+      soundController.update();
+    }
+
+    if constexpr (debug::boot)
+    {
+      if(soundController.isReady())
+      {
+        bootProfiler.mark(BootStep::Sound);
+      }
+
+      bootProfiler.report(Serial);
+    }
 
     if(const auto onIdle = phaseFunctions[static_cast<uint8_t>(phase)].onIdle)
     {
+      ProfileScope zone(ProfileZone::Game);
       (this->*onIdle)();
     }
 
-    ledController.display();
+    {
+      ProfileScope zone(ProfileZone::Led);
+      ledController.display();
+    }
+
+    profiler.endFrame();
+
+    if constexpr (debug::serial)
+    {
+      report(now);
+    }
   }
 };
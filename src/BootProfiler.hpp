@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <Arduino.h>
+
+#include "debug.hpp"
+#include "str.hpp"
+#include "utils.hpp"
+
+enum class BootStep : uint8_t
+{
+    Storage,
+    Displays,
+    JoinScreen,
+    Sound,
+
+    Count
+};
+
+// Time from reset to each boot milestone: settings loaded, displays lit (the first pixel), the
+// join screen drawn and the sound module answering. Printed once they all happened.
+// Only the specialisation for Enabled = true carries any state.
+template<bool Enabled>
+class BootProfiler
+{
+public:
+    void mark(BootStep) {}
+    void report(Print&) {}
+};
+
+template<>
+class BootProfiler<true>
+{
+    static constexpr uint8_t stepCount = static_cast<uint8_t>(BootStep::Count);
+    static constexpr uint8_t allSteps = (1 << stepCount) - 1;
+
+    static constexpr PROGMEM const char* names[stepCount] =
+    {
+        "storage"_PSTR,
+        "displays"_PSTR,
+        "join screen"_PSTR,
+        "sound"_PSTR,
+    };
+
+    uint32_t times[stepCount] = {};
+    uint8_t marked = 0;
+    bool reported = false;
+
+public:
+    // Only the first time counts
+    void mark(BootStep step)
+    {
+        const uint8_t bit = 1 << static_cast<uint8_t>(step);
+        if(marked & bit)
+        {
+            return;
+        }
+
+        marked |= bit;
+        times[static_cast<uint8_t>(step)] = micros();
+    }
+
+    void report(Print& out)
+    {
+        if(reported || marked != allSteps)
+        {
+            return;
+        }
+
+        reported = true;
+
+        for(uint8_t x = 0; x < stepCount; x++)
+        {
+            out.print(F("boot "));
+            out.print(reinterpret_cast<const __FlashStringHelper*>(readPgm(&names[x])));
+            out.print(' ');
+            out.print(times[x] / 1000);
+            out.print('.');
+            out.print(times[x] / 100 % 10);
+            out.println(F("ms"));
+        }
+    }
+};
+
+inline BootProfiler<debug::boot> bootProfiler;
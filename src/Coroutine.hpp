@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+
+// Stackless coroutine in the protothread style, for scripting a phase as a timeline.
+// The handler is called every frame and jumps back to where it last yielded, so locals do not
+// survive a yield: whatever must persist lives in the game data. A script costs this struct and
+// nothing else, no frame is ever allocated.
+//
+// Only one CO_ macro per line, resume points are keyed on __LINE__.
+struct Coroutine
+{
+    static constexpr uint16_t finished = 0xFFFF;
+
+    uint16_t line = 0;
+    uint16_t wait = 0;
+
+    bool isFinished() const
+    {
+        return line == finished;
+    }
+};
+
+// While a delay runs the handler returns before reaching the script
+#define CO_BEGIN(co, deltaTime)                 \
+    if((co).wait > (deltaTime))                 \
+    {                                           \
+        (co).wait -= (deltaTime);               \
+        return;                                 \
+    }                                           \
+    (co).wait = 0;                              \
+    switch((co).line)                           \
+    {                                           \
+        case 0:
+
+// Give the frame back, typically once the display was drawn
+#define CO_YIELD(co)                            \
+    do                                          \
+    {                                           \
+        (co).line = __LINE__;                   \
+        return;                                 \
+        case __LINE__:;                         \
+    } while(0)
+
+// Resume once condition holds, checked once per frame
+#define CO_AWAIT(co, condition)                 \
+    do                                          \
+    {                                           \
+        (co).line = __LINE__;                   \
+        case __LINE__:                          \
+        if(!(condition))                        \
+        {                                       \
+            return;                             \
+        }                                       \
+    } while(0)
+
+// Resume after ms milliseconds of frame time, up to 65s
+#define CO_DELAY(co, ms)                        \
+    do                                          \
+    {                                           \
+        (co).wait = (ms);                       \
+        CO_YIELD(co);                           \
+    } while(0)
+
+#define CO_END(co)                              \
+    }                                           \
+    (co).line = Coroutine::finished
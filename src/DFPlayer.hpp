@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace DFPlayer
+{
+    static constexpr uint8_t FrameSize = 10;
+
+    static constexpr uint8_t StartByte = 0x7E;
+    static constexpr uint8_t VersionByte = 0xFF;
+    static constexpr uint8_t LengthByte = 0x06;
+    static constexpr uint8_t EndByte = 0xEF;
+
+    enum class Command : uint8_t
+    {
+        Play = 0x03,
+        Volume = 0x06,
+        Reset = 0x0C,
+        Resume = 0x0D,
+        Pause = 0x0E,
+        Stop = 0x16,
+        SingleLoop = 0x19, // 0 = enable, 1 = disable
+
+        QueryStatus = 0x42,
+    };
+
+    enum class Reply : uint8_t
+    {
+        UsbFinished = 0x3C,
+        CardFinished = 0x3D,
+        FlashFinished = 0x3E,
+        Initialized = 0x3F,
+        Error = 0x40,
+        Ack = 0x41,
+        Status = 0x42,
+    };
+
+    struct Frame
+    {
+        uint8_t command{};
+        uint16_t param{};
+    };
+
+    inline uint16_t checksum(const uint8_t* frame)
+    {
+        uint16_t sum = 0;
+        for(uint8_t x = 1; x < 7; x++)
+        {
+            sum += frame[x];
+        }
+
+        return -sum;
+    }
+
+    inline void encode(uint8_t* frame, Command command, uint16_t param, bool ack)
+    {
+        frame[0] = StartByte;
+        frame[1] = VersionByte;
+        frame[2] = LengthByte;
+        frame[3] = static_cast<uint8_t>(command);
+        frame[4] = ack;
+        frame[5] = param >> 8;
+        frame[6] = param;
+
+        const auto sum = checksum(frame);
+        frame[7] = sum >> 8;
+        frame[8] = sum;
+        frame[9] = EndByte;
+    }
+
+    // Reassembles reply frames from the serial byte stream, resynchronising on the start byte
+    class Parser
+    {
+        uint8_t buffer[FrameSize] = {};
+        uint8_t used = 0;
+
+    public:
+        Frame frame = {};
+
+        bool push(uint8_t byte)
+        {
+            if(used == 0 && byte != StartByte)
+            {
+                return false;
+            }
+
+            buffer[used++] = byte;
+            if(used < FrameSize)
+            {
+                return false;
+            }
+
+            used = 0;
+
+            if(buffer[1] != VersionByte || buffer[2] != LengthByte || buffer[9] != EndByte)
+            {
+                return false;
+            }
+
+            const uint16_t sum = (static_cast<uint16_t>(buffer[7]) << 8) | buffer[8];
+            if(sum != checksum(buffer))
+            {
+                return false;
+            }
+
+            frame.command = buffer[3];
+            frame.param = (static_cast<uint16_t>(buffer[5]) << 8) | buffer[6];
+
+            return true;
+        }
+    };
+}
@@ -5,7 +5,8 @@
 #include "SimpleI2C.h"
 #include "font.hpp"
 #include "DisplayBuffer.hpp"
-#include "Glyphs.hpp"
+#include "glyphs.hpp"
+#include "Profiler.hpp"
 
 class Display
 {
@@ -123,6 +124,8 @@ public:
 
     auto selectScreen(Screen screen)
     {
+        ProfileScope zone(ProfileZone::Mux);
+
         SI2C.start();
         SI2C.sendAddresWrite(0b01110000);
         SI2C.write(screen);
@@ -205,6 +208,8 @@ public:
     }
     void clearRect(uint8_t x = 0, uint8_t y = 0, uint8_t width = Width, uint8_t height = Height)
     {
+        ProfileScope zone(ProfileZone::Display);
+
         startDraw(x, y, width, height);
 
         const auto byteCount = static_cast<uint16_t>(width) * height / 8;
@@ -217,6 +222,8 @@ public:
 
     void startDraw(uint8_t x = 0, uint8_t y = 0, uint8_t width = Width, uint8_t height = Height)
     {
+        ProfileScope zone(ProfileZone::Display);
+
         SI2C.start();
         SI2C.sendAddresWrite(Address);
 
@@ -238,12 +245,29 @@ public:
     template <uint8_t Width, uint8_t Height>
     void draw(const DisplayBuffer<Width, Height>& buffer, uint8_t x = 0, uint8_t y = 0)
     {
+        ProfileScope zone(ProfileZone::Display);
+
         startDraw(x, y, Width, ((Height + 7) / 8) * 8);
         SI2C.write(&buffer.data[0], buffer.byteCount);
     }
 
+    // Only the columns [column, column + width) of the pages [page, page + pages) of buffer
+    template <uint8_t Width, uint8_t Height>
+    void drawArea(const DisplayBuffer<Width, Height>& buffer, uint8_t x, uint8_t y, uint8_t column, uint8_t page, uint8_t width, uint8_t pages)
+    {
+        ProfileScope zone(ProfileZone::Display);
+
+        startDraw(x + column, y + page * 8, width, pages * 8);
+        for(uint8_t row = page; row < page + pages; row++)
+        {
+            SI2C.write(&buffer.data[row * Width + column], width);
+        }
+    }
+
     void draw(const Glyph& glyph, uint8_t x = 0, uint8_t y = 0)
     {
+        ProfileScope zone(ProfileZone::Display);
+
         const auto g = readPgm(glyph);
         startDraw(x, y, g.width, ((g.height + 7) / 8) * 8);
         
@@ -252,6 +276,8 @@ public:
 
     void print(char c)
     {
+        ProfileScope zone(ProfileZone::Display);
+
         SI2C.write_P(Font::getChar(c), Font::charWidth);
     }
 
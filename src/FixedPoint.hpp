@@ -2,162 +2,414 @@
 
 #include <stdint.h>
 
-//template<uint8_t M = 8, uint8_t N = 8>
-class FixedPoint
+namespace FixedMath
 {
-    union
+    template<uint8_t Bits>
+    struct Types;
+
+    template<>
+    struct Types<8>
     {
-        int16_t raw;
+        using Signed = int8_t;
+        using Unsigned = uint8_t;
+        using WideSigned = int16_t;
+        using WideUnsigned = uint16_t;
+    };
 
-        struct
-        {
-            uint8_t lower;
-            int8_t upper;
-        };
+    template<>
+    struct Types<16>
+    {
+        using Signed = int16_t;
+        using Unsigned = uint16_t;
+        using WideSigned = int32_t;
+        using WideUnsigned = uint32_t;
     };
 
-    static constexpr uint8_t M = 8;
-    static constexpr uint8_t N = 8;
-    static constexpr uint8_t K = 1 << (N - 1);
+    template<>
+    struct Types<32>
+    {
+        using Signed = int32_t;
+        using Unsigned = uint32_t;
+        using WideSigned = int64_t;
+        using WideUnsigned = uint64_t;
+    };
 
-public:
-    constexpr FixedPoint(int8_t integer, uint8_t fraction = 0) : lower(fraction), upper(integer)
+    template<bool Condition, typename True, typename False>
+    struct Select
+    {
+        using Type = True;
+    };
+
+    template<typename True, typename False>
+    struct Select<false, True, False>
     {
+        using Type = False;
+    };
+
+    // Smallest of the integer types holding that many bits
+    constexpr uint8_t storageBits(uint8_t bits)
+    {
+        return bits <= 8 ? 8 : (bits <= 16 ? 16 : 32);
     }
 
-    constexpr FixedPoint() : raw(0)
+    constexpr int16_t multiply(int8_t a, int8_t b)
     {
+        return static_cast<int16_t>(a) * b;
     }
 
-    constexpr int16_t getRaw() const
+    constexpr uint16_t multiply(uint8_t a, uint8_t b)
     {
-        return raw;
+        return static_cast<uint16_t>(a) * b;
     }
 
-    constexpr int8_t getInteger() const
+    // 16x16 -> 32 straight from the four 8x8 partial products (AVR201), the generic version goes
+    // through the libgcc widening multiply. Constant evaluation takes the portable path.
+    constexpr int32_t multiply(int16_t a, int16_t b)
     {
-        return upper;
+        if consteval
+        {
+            return static_cast<int32_t>(a) * b;
+        }
+        else
+        {
+#ifdef __AVR__
+            int32_t result;
+            uint8_t zero;
+
+            asm(
+                "clr   %[zero]              \n\t"
+                "muls  %B[a], %B[b]         \n\t"
+                "movw  %C[result], r0       \n\t"
+                "mul   %A[a], %A[b]         \n\t"
+                "movw  %A[result], r0       \n\t"
+                "mulsu %B[a], %A[b]         \n\t"
+                "sbc   %D[result], %[zero]  \n\t"
+                "add   %B[result], r0       \n\t"
+                "adc   %C[result], r1       \n\t"
+                "adc   %D[result], %[zero]  \n\t"
+                "mulsu %B[b], %A[a]         \n\t"
+                "sbc   %D[result], %[zero]  \n\t"
+                "add   %B[result], r0       \n\t"
+                "adc   %C[result], r1       \n\t"
+                "adc   %D[result], %[zero]  \n\t"
+                "clr   __zero_reg__         \n\t"
+                : [result] "=&r" (result), [zero] "=&r" (zero)
+                : [a] "a" (a), [b] "a" (b)
+                : "r0"
+            );
+
+            return result;
+#else
+            return static_cast<int32_t>(a) * b;
+#endif
+        }
     }
 
-    constexpr uint8_t getFraction() const
+    constexpr uint32_t multiply(uint16_t a, uint16_t b)
     {
-        return lower;
+        if consteval
+        {
+            return static_cast<uint32_t>(a) * b;
+        }
+        else
+        {
+#ifdef __AVR__
+            uint32_t result;
+            uint8_t zero;
+
+            asm(
+                "clr   %[zero]              \n\t"
+                "mul   %B[a], %B[b]         \n\t"
+                "movw  %C[result], r0       \n\t"
+                "mul   %A[a], %A[b]         \n\t"
+                "movw  %A[result], r0       \n\t"
+                "mul   %B[a], %A[b]         \n\t"
+                "add   %B[result], r0       \n\t"
+                "adc   %C[result], r1       \n\t"
+                "adc   %D[result], %[zero]  \n\t"
+                "mul   %B[b], %A[a]         \n\t"
+                "add   %B[result], r0       \n\t"
+                "adc   %C[result], r1       \n\t"
+                "adc   %D[result], %[zero]  \n\t"
+                "clr   __zero_reg__         \n\t"
+                : [result] "=&r" (result), [zero] "=&r" (zero)
+                : [a] "r" (a), [b] "r" (b)
+                : "r0"
+            );
+
+            return result;
+#else
+            return static_cast<uint32_t>(a) * b;
+#endif
+        }
     }
 
-    constexpr void setInteger(int8_t integer)
+    constexpr int64_t multiply(int32_t a, int32_t b)
     {
-        upper = integer;
+        return static_cast<int64_t>(a) * b;
     }
 
-    constexpr void setFraction(uint8_t fraction)
+    constexpr uint64_t multiply(uint32_t a, uint32_t b)
     {
-        lower = fraction;
+        return static_cast<uint64_t>(a) * b;
     }
+}
+
+// Q IntBits.FracBits in an 8, 16 or 32 bit integer, the sign bit counts as an integer bit.
+// + and - wrap around, * and / round to the nearest and saturate, see the named functions for the
+// other variants.
+template<uint8_t IntBits, uint8_t FracBits, bool Signed = true>
+class Fixed
+{
+public:
+    static constexpr uint8_t totalBits = IntBits + FracBits;
+    static_assert(totalBits == 8 || totalBits == 16 || totalBits == 32, "Fixed only comes in 8, 16 and 32 bits");
+    static_assert(IntBits > 0 && FracBits > 0);
+
+    using Types = FixedMath::Types<totalBits>;
+    using IntegerTypes = FixedMath::Types<FixedMath::storageBits(IntBits)>;
 
-    static constexpr FixedPoint fromRaw(int16_t raw)
+    using Raw = typename FixedMath::Select<Signed, typename Types::Signed, typename Types::Unsigned>::Type;
+    using Wide = typename FixedMath::Select<Signed, typename Types::WideSigned, typename Types::WideUnsigned>::Type;
+    using Integer = typename FixedMath::Select<Signed, typename IntegerTypes::Signed, typename IntegerTypes::Unsigned>::Type;
+    using Fraction = typename FixedMath::Types<FixedMath::storageBits(FracBits)>::Unsigned;
+
+    static constexpr typename Types::Unsigned fractionMask = (static_cast<typename Types::Unsigned>(1) << FracBits) - 1;
+
+    static constexpr Raw rawHighest = Signed ? static_cast<typename Types::Unsigned>(-1) >> 1 : static_cast<typename Types::Unsigned>(-1);
+    static constexpr Raw rawLowest = Signed ? -rawHighest - 1 : 0;
+
+private:
+    Raw raw;
+
+    static constexpr Wide roundShift(Wide product)
+    {
+        return (product + (static_cast<Wide>(1) << (FracBits - 1))) >> FracBits;
+    }
+
+public:
+    constexpr Fixed(Integer integer, Fraction fraction = 0) : raw(static_cast<Raw>((static_cast<Wide>(integer) << FracBits) | fraction))
     {
-        FixedPoint fp;
+    }
+
+    constexpr Fixed() : raw(0)
+    {
+    }
+
+    // Wraps like the integer conversions, the fraction is truncated towards -infinity
+    template<uint8_t OtherInt, uint8_t OtherFrac, bool OtherSigned>
+    constexpr explicit Fixed(Fixed<OtherInt, OtherFrac, OtherSigned> other) : raw(0)
+    {
+        if constexpr(OtherFrac > FracBits)
+        {
+            raw = static_cast<Raw>(other.getRaw() >> (OtherFrac - FracBits));
+        }
+        else
+        {
+            raw = static_cast<Raw>(static_cast<Wide>(other.getRaw()) << (FracBits - OtherFrac));
+        }
+    }
+
+    // Rounded to the nearest instead, still wrapping
+    template<uint8_t OtherInt, uint8_t OtherFrac, bool OtherSigned>
+    static constexpr Fixed rounded(Fixed<OtherInt, OtherFrac, OtherSigned> other)
+    {
+        if constexpr(OtherFrac > FracBits)
+        {
+            using OtherWide = typename Fixed<OtherInt, OtherFrac, OtherSigned>::Wide;
+            constexpr uint8_t shift = OtherFrac - FracBits;
+            return fromRaw(static_cast<Raw>((static_cast<OtherWide>(other.getRaw()) + (static_cast<OtherWide>(1) << (shift - 1))) >> shift));
+        }
+        else
+        {
+            return Fixed(other);
+        }
+    }
+
+    // For the constants only, there is no float at run time
+    static consteval Fixed fromFloat(float value)
+    {
+        const float scaled = value * (static_cast<Wide>(1) << FracBits);
+        if(!Signed && scaled <= 0)
+        {
+            return Fixed();
+        }
+
+        return fromRaw(saturate(static_cast<Wide>(scaled < 0 ? scaled - 0.5f : scaled + 0.5f)));
+    }
+
+    static constexpr Fixed fromRaw(Raw raw)
+    {
+        Fixed fp;
         fp.raw = raw;
         return fp;
     }
 
-    static constexpr int16_t sat16(int32_t x)
+    static constexpr Raw saturate(Wide x)
+    {
+        if(x > rawHighest)
+        {
+            return rawHighest;
+        }
+
+        if constexpr(Signed)
+        {
+            if(x < rawLowest)
+            {
+                return rawLowest;
+            }
+        }
+
+        return static_cast<Raw>(x);
+    }
+
+    constexpr Raw getRaw() const
+    {
+        return raw;
+    }
+
+    // Rounded towards -infinity
+    constexpr Integer getInteger() const
+    {
+        return static_cast<Integer>(raw >> FracBits);
+    }
+
+    constexpr Fraction getFraction() const
     {
-        if (x > 32767) return 32767;
-        else if (x < -32768) return -32768;
-        else return (int16_t)x;
+        return static_cast<Fraction>(raw & fractionMask);
     }
 
-    constexpr FixedPoint operator-() const
+    constexpr void setInteger(Integer integer)
+    {
+        raw = static_cast<Raw>((static_cast<Wide>(integer) << FracBits) | getFraction());
+    }
+
+    constexpr void setFraction(Fraction fraction)
+    {
+        raw = static_cast<Raw>((raw & ~fractionMask) | fraction);
+    }
+
+    constexpr Fixed operator-() const requires Signed
     {
         return fromRaw(-raw);
     }
 
-    constexpr FixedPoint& operator+=(FixedPoint b)
+    constexpr Fixed& operator+=(Fixed b)
     {
         *this = *this + b;
         return *this;
     }
 
-    constexpr FixedPoint& operator-=(FixedPoint b)
+    constexpr Fixed& operator-=(Fixed b)
     {
         *this = *this - b;
         return *this;
     }
 
-    friend inline FixedPoint operator+(FixedPoint a, FixedPoint b);
-    friend inline FixedPoint operator-(FixedPoint a, FixedPoint b);
-    friend inline FixedPoint operator*(FixedPoint a, FixedPoint b);
-    friend inline FixedPoint operator/(FixedPoint a, FixedPoint b);
+    constexpr Fixed& operator*=(Fixed b)
+    {
+        *this = *this * b;
+        return *this;
+    }
 
-    friend inline bool operator==(FixedPoint a, FixedPoint b);
-    friend inline bool operator!=(FixedPoint a, FixedPoint b);
-    friend inline bool operator<(FixedPoint a, FixedPoint b);
-    friend inline bool operator<=(FixedPoint a, FixedPoint b);
-    friend inline bool operator>(FixedPoint a, FixedPoint b);
-    friend inline bool operator>=(FixedPoint a, FixedPoint b);
-};
+    constexpr Fixed& operator/=(Fixed b)
+    {
+        *this = *this / b;
+        return *this;
+    }
 
-inline FixedPoint operator+(FixedPoint a, FixedPoint b)
-{
-    return FixedPoint::fromRaw(a.raw + b.raw);
-}
+    friend constexpr Fixed operator+(Fixed a, Fixed b)
+    {
+        return fromRaw(static_cast<Raw>(a.raw + b.raw));
+    }
 
-inline FixedPoint operator-(FixedPoint a, FixedPoint b)
-{
-    return FixedPoint::fromRaw(a.raw - b.raw);
-}
+    friend constexpr Fixed operator-(Fixed a, Fixed b)
+    {
+        return fromRaw(static_cast<Raw>(a.raw - b.raw));
+    }
 
-inline FixedPoint operator*(FixedPoint a, FixedPoint b)
-{
-    int32_t temp = (int32_t)a.getRaw() * (int32_t)b.getRaw();
-    temp += FixedPoint::K;
-    temp >>= FixedPoint::N;
-    return FixedPoint::fromRaw(FixedPoint::sat16(temp));
-}
+    friend constexpr Fixed operator*(Fixed a, Fixed b)
+    {
+        return fromRaw(saturate(roundShift(FixedMath::multiply(a.raw, b.raw))));
+    }
 
-inline FixedPoint operator/(FixedPoint a, FixedPoint b)
-{
-    int32_t temp = (int32_t)a.raw << FixedPoint::N;
-    
-    if ((temp >= 0 && b.raw >= 0) || (temp < 0 && b.raw < 0))
-    {   
-        temp += b.raw / 2;
+    // Rounded half away from zero, dividing by zero gives the bound on the side of a
+    friend constexpr Fixed operator/(Fixed a, Fixed b)
+    {
+        if(b.raw == 0)
+        {
+            return fromRaw(a.raw < 0 ? rawLowest : rawHighest);
+        }
+
+        Wide temp = static_cast<Wide>(a.raw) << FracBits;
+
+        if((temp < 0) == (b.raw < 0))
+        {
+            temp += b.raw / 2;
+        }
+        else
+        {
+            temp -= b.raw / 2;
+        }
+
+        return fromRaw(saturate(temp / b.raw));
     }
-    else
+
+    friend constexpr Fixed saturatingAdd(Fixed a, Fixed b)
     {
-        temp -= b.raw / 2;
+        return fromRaw(saturate(static_cast<Wide>(a.raw) + b.raw));
     }
 
-    return FixedPoint::fromRaw(temp / b.raw);
-}
+    friend constexpr Fixed saturatingSub(Fixed a, Fixed b)
+    {
+        if constexpr(!Signed)
+        {
+            return fromRaw(a.raw > b.raw ? a.raw - b.raw : 0);
+        }
 
-inline bool operator==(FixedPoint a, FixedPoint b)
-{
-    return a.raw == b.raw;
-}
+        return fromRaw(saturate(static_cast<Wide>(a.raw) - b.raw));
+    }
 
-inline bool operator!=(FixedPoint a, FixedPoint b)
-{
-    return a.raw != b.raw;
-}
+    friend constexpr Fixed wrappingMul(Fixed a, Fixed b)
+    {
+        return fromRaw(static_cast<Raw>(roundShift(FixedMath::multiply(a.raw, b.raw))));
+    }
 
-inline bool operator<(FixedPoint a, FixedPoint b)
-{
-    return a.raw < b.raw;
-}
+    friend constexpr bool operator==(Fixed a, Fixed b)
+    {
+        return a.raw == b.raw;
+    }
 
-inline bool operator<=(FixedPoint a, FixedPoint b)
-{
-    return a.raw <= b.raw;
-}
+    friend constexpr bool operator!=(Fixed a, Fixed b)
+    {
+        return a.raw != b.raw;
+    }
 
-inline bool operator>(FixedPoint a, FixedPoint b)
-{
-    return a.raw > b.raw;
-}
+    friend constexpr bool operator<(Fixed a, Fixed b)
+    {
+        return a.raw < b.raw;
+    }
 
-inline bool operator>=(FixedPoint a, FixedPoint b)
-{
-    return a.raw >= b.raw;
-}
\ No newline at end of file
+    friend constexpr bool operator<=(Fixed a, Fixed b)
+    {
+        return a.raw <= b.raw;
+    }
+
+    friend constexpr bool operator>(Fixed a, Fixed b)
+    {
+        return a.raw > b.raw;
+    }
+
+    friend constexpr bool operator>=(Fixed a, Fixed b)
+    {
+        return a.raw >= b.raw;
+    }
+};
+
+using Q8_8 = Fixed<8, 8>;
+using Q4_12 = Fixed<4, 12>;
+using Q16_16 = Fixed<16, 16>;
+using UQ8_8 = Fixed<8, 8, false>;
+using UQ16_16 = Fixed<16, 16, false>;
+
+using FixedPoint = Q8_8;
@@ -1,15 +1,47 @@
 #pragma once
 
+#include <stdint.h>
+
 struct GameState;
 struct Display;
 struct Input;
 struct LedController;
 struct SoundController;
 
-struct GameDefinition
+enum class GamePhase : int8_t
+{
+    None = -1,
+    Init,
+    Title,
+    Demo,
+    Instructions,
+    Countdown,
+    Running,
+    Zaps,
+    GameResults,
+    Scores,
+    Finished,
+
+    Count
+};
+
+constexpr uint8_t GamePhaseCount = static_cast<uint8_t>(GamePhase::Count);
+
+using PhaseHandler = void (*)(GameState&, Display&, Input&, LedController&, SoundController&);
+
+// onEnter runs once in the frame the phase is reached, onUpdate in every following frame and
+// onExit once when it is left. Empty handlers are skipped.
+struct PhaseHandlers
 {
-    using Func = void (*)(GameState&, Display&, Input&, LedController&, SoundController&);
+    PhaseHandler onEnter{};
+    PhaseHandler onUpdate{};
+    PhaseHandler onExit{};
+};
 
+struct GameDefinition
+{
     const char* title = nullptr;
-    Func update = nullptr;
-};
\ No newline at end of file
+
+    // PROGMEM table indexed by GamePhase, GamePhaseCount entries
+    const PhaseHandlers* phases = nullptr;
+};
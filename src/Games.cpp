@@ -4,47 +4,22 @@
 #include "input.hpp"
 #include "Display.hpp"
 #include "LedController.hpp"
+#include "Tuning.hpp"
 #include "debug.hpp"
 
-void GameRunner::update(uint8_t deltaTime, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+namespace
 {
-    if(state.gameIndex < 0)
-    {
-        return;
-    }
-    
-    const auto phase = state.phase;
-
-    if(state.lastPhase != phase)
-    {
-        display.selectScreen(Display::Screen::Players);
-        display.clearRect();
-    }
-
-    state.deltaTime = deltaTime;
-    state.phaseDuration += state.deltaTime;
-
-    if(definition.update)
-    {
-        definition.update(state, display, input, ledController, soundController);
-    }
-
-    if(phase == GameState::Phase::Init)
+    void initGame(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
     {
         state.playCount[state.gameIndex]++;
         state.advance();
     }
-    else if(phase == GameState::Phase::Title)
-    {
-        if constexpr (debug::fastPath)
-        {
-            state.advance();
-            return;
-        }
 
+    void drawTitle(GameState& state, Display& display)
+    {
         display.selectPlayers(state.playerPresence);
 
-        const auto title = definition.title;
+        const auto title = readPgm(gameDefinitions[state.gameIndex]).title;
         const auto len = strlen_P(title);
         const auto msgWidth = len * (Font::charWidth + 1);
         display.startDraw(Display::Width / 2 - msgWidth / 2, 2 * 8, msgWidth, 8);
@@ -54,7 +29,7 @@ void GameRunner::update(uint8_t deltaTime, Display& display, Input& input, LedCo
         display.printP("lvl. "_PSTR);
         display.print_L((long)state.playCount[state.gameIndex]);
 
-        static constexpr const char* difficultyStrs[] = 
+        static constexpr const char* difficultyStrs[] =
         {
             "EASY"_PSTR,
             "NORMAL"_PSTR,
@@ -67,18 +42,25 @@ void GameRunner::update(uint8_t deltaTime, Display& display, Input& input, LedCo
             display.startDraw(Display::Width / 2 - (Font::charWidth + 1) * 3, 6 * 8, 50, 8);
             display.printP(difficultyStrs[static_cast<int32_t>(difficulty)]);
         }
+    }
 
-        constexpr auto titleDuration = 2000;
-        if(state.phaseDuration >= titleDuration)
+    void playTitle(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        auto& co = state.runnerScript;
+        CO_BEGIN(co, state.deltaTime);
+
+        if(!debug::fastPath)
         {
-            state.advance();
+            drawTitle(state, display);
+            CO_DELAY(co, Tuning::get(TuningId::TitleDuration));
         }
-    }
-    else if(phase == GameState::Phase::Demo)
-    {
 
+        state.advance();
+
+        CO_END(co);
     }
-    else if(phase == GameState::Phase::Instructions)
+
+    void drawReadyPrompt(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
     {
         for(uint8_t x = 0; x < state.maxPlayerCount; x++)
         {
@@ -87,11 +69,20 @@ void GameRunner::update(uint8_t deltaTime, Display& display, Input& input, LedCo
                 continue;
             }
 
-            if(state.lastPhase != phase)
+            display.selectScreenfromIndex(x);
+            display.startDraw(0, Display::Height - 8, Display::Width, 8);
+            display.printP("Press button to ready"_PSTR);
+        }
+    }
+
+    // Marks the players who pressed this frame, true once everybody is ready
+    bool markReadyPlayers(GameState& state, Display& display, Input& input)
+    {
+        for(uint8_t x = 0; x < state.maxPlayerCount; x++)
+        {
+            if(!state.isPlayerPresent(x))
             {
-                display.selectScreenfromIndex(x);
-                display.startDraw(0, Display::Height - 8, Display::Width, 8);
-                display.printP("Press button to ready"_PSTR);
+                continue;
             }
 
             if(input.isNewPressed(input.buttonFromIndex(x)))
@@ -108,135 +99,256 @@ void GameRunner::update(uint8_t deltaTime, Display& display, Input& input, LedCo
             }
         }
 
-        if(state.areAllPlayersReady())
-        {
-            state.advance();
-        }
+        return state.areAllPlayersReady();
     }
-    else if(phase == GameState::Phase::Countdown)
+
+    void updateReady(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
     {
-        if constexpr (debug::fastPath)
+        auto& co = state.runnerScript;
+        CO_BEGIN(co, state.deltaTime);
+
+        CO_AWAIT(co, markReadyPlayers(state, display, input));
+        state.advance();
+
+        CO_END(co);
+    }
+
+    void playCountdown(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        static constexpr uint8_t x = Display::Width / 2 - 32 / 2;
+        static constexpr uint8_t y = Display::Height / 2 - 48 / 2;
+
+        auto& co = state.runnerScript;
+        CO_BEGIN(co, state.deltaTime);
+
+        if(!debug::fastPath)
         {
-            state.advance();
-            return;
+            display.selectPlayers(state.playerPresence);
+            display.draw(Glyphs::big3, x, y);
+            CO_DELAY(co, Tuning::get(TuningId::CountdownStep));
+
+            display.selectPlayers(state.playerPresence);
+            display.draw(Glyphs::big2, x, y);
+            CO_DELAY(co, Tuning::get(TuningId::CountdownStep));
+
+            display.selectPlayers(state.playerPresence);
+            display.draw(Glyphs::big1, x, y);
+            CO_DELAY(co, Tuning::get(TuningId::CountdownStep));
         }
 
-        display.selectPlayers(state.playerPresence);
+        state.advance();
+
+        CO_END(co);
+    }
+
+    void startZaps(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        static constexpr PROGMEM LedAnimation::Keyframe zapKeys[] =
+        {
+            {0, 0xFF0000, LedAnimation::Ease::Step},
+            {80, 0x000000, LedAnimation::Ease::Step},
+            {160, 0xFF0000, LedAnimation::Ease::Step},
+            {240, 0x000000, LedAnimation::Ease::Step},
+            {320, 0xFF0000},
+            {800, 0x000000},
+        };
+        static constexpr PROGMEM auto zapFlash = LedAnimation::makeTrack(zapKeys);
 
-        if(state.phaseDuration < 1000)
+        if(state.playerPresence & ~state.playerAlive)
         {
-            display.draw(Glyphs::big3, Display::Width / 2 - 32 / 2, Display::Height / 2 - 48 / 2);
+            ledController.play(LedController::Layer::Flash, zapFlash);
         }
-        else if(state.phaseDuration < 2000)
+
+        uint8_t zapCount = 0;
+        for(int8_t x = 0; x < GameState::maxPlayerCount; x++)
         {
-            display.draw(Glyphs::big2, Display::Width / 2 - 32 / 2, Display::Height / 2 - 48 / 2);
+            if(state.isPlayerDead(x))
+            {
+                zapCount++;
+            }
         }
-        else if(state.phaseDuration < 3000)
+
+        for(int8_t x = 0; x < GameState::maxPlayerCount; x++)
         {
-            display.draw(Glyphs::big1, Display::Width / 2 - 32 / 2, Display::Height / 2 - 48 / 2);
+            if(state.isPlayerDead(x))
+            {
+                input.zap(x, zapCount > 1 ? 50 : 80);
+
+                state.scores[x]++;
+
+                display.selectScreenfromIndex(x);
+
+                constexpr auto msg = "ZAP!"_PSTR;
+                const auto msgWidth = strlen_constexpr(msg) * (Font::charWidth + 1);
+                display.startDraw(Display::Width / 2 - msgWidth / 2, 4 * 8, msgWidth, 8);
+                display.printP(msg);
+            }
         }
-        else
+    }
+
+    void updateZaps(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        if(state.phaseDuration >= Tuning::get(TuningId::ZapsDuration))
         {
             state.advance();
         }
     }
-    else if(phase == GameState::Phase::Zaps)
+
+    void drawScores(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
     {
-        if(state.lastPhase != phase)
+        static constexpr PROGMEM LedAnimation::Keyframe scoreKeys[] =
         {
-            uint8_t zapCount = 0;
-            for(int8_t x = 0; x < GameState::maxPlayerCount; x++)
+            {0, 0x000000},
+            {500, 0xFFB000},
+            {1000, 0x000000},
+            {1500, 0xFFB000},
+            {2000, 0x000000},
+            {2500, 0xFFB000},
+            {3000, 0x000000},
+        };
+        static constexpr PROGMEM auto scorePulse = LedAnimation::makeTrack(scoreKeys, false, 50);
+
+        ledController.play(LedController::Layer::Game, scorePulse);
+
+        display.selectPlayers(state.playerPresence);
+
+        display.startDraw(22, 0, Display::Width - 22, 8);
+        display.printP("Player"_PSTR);
+
+        display.startDraw(95 - Font::charAdvance * 4 / 2 + Font::charAdvance / 2, 0, Display::Width - 95, 8);
+        display.printP("Zaps"_PSTR);
+
+        uint8_t playerOrder[GameState::maxPlayerCount] = {};
+        uint8_t playerCount = 0;
+        for(int8_t x = 0; x < GameState::maxPlayerCount; x++)
+        {
+            if(state.isPlayerPresent(x))
             {
-                if(state.isPlayerDead(x))
-                {
-                    zapCount++;
-                }
+                playerOrder[playerCount++] = x;
             }
+        }
+
+        sort(playerOrder, state.scores, playerCount);
+
+        uint8_t ranking = 0;
+        for(int8_t x = 0; x < playerCount; x++)
+        {
+            const auto playerIndex = playerOrder[x];
+            const auto name = state.names[playerIndex];
+            const auto score = state.scores[playerIndex];
 
-            for(int8_t x = 0; x < GameState::maxPlayerCount; x++)
+            if(x == 0 || score != state.scores[playerOrder[x - 1]])
             {
-                if(state.isPlayerDead(x))
-                {
-                    input.zap(x, zapCount > 1 ? 50 : 80);
+                ranking++;
+            }
 
-                    state.scores[x]++;
+            display.startDraw(0, 8 + 2 * 8 * x, Display::Width - 0, 8);
+            display.print('#');
+            display.printSpace();
+            display.print('0' + ranking);
 
-                    display.selectScreenfromIndex(x);
+            display.startDraw(22 + 15, 8 + 2 * 8 * x, Font::charAdvance, 8);
+            display.print(name);
 
-                    constexpr auto msg = "ZAP!"_PSTR;
-                    const auto msgWidth = strlen_constexpr(msg) * (Font::charWidth + 1);
-                    display.startDraw(Display::Width / 2 - msgWidth / 2, 4 * 8, msgWidth, 8);
-                    display.printP(msg);
-                }
-            }
+            display.startDraw(95, 8 + 2 * 8 * x, Display::Width - 95, 8);
+            display.print_UL(score);
         }
+    }
 
-        constexpr auto zapsDuration = 1000;
-        if(state.phaseDuration >= zapsDuration)
+    void updateScores(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        if(state.phaseDuration > Tuning::get(TuningId::ScoresDuration))
         {
             state.advance();
         }
     }
-    else if(phase == GameState::Phase::GameResults)
+
+    // What every game goes through, run after the handlers of the game itself
+    PROGMEM const PhaseHandlers runnerPhases[GamePhaseCount] =
     {
-    }
-    else if(phase == GameState::Phase::Scores)
+        {.onEnter=initGame},
+        {.onUpdate=playTitle},
+        {},
+        {.onEnter=drawReadyPrompt, .onUpdate=updateReady},
+        {.onUpdate=playCountdown},
+        {},
+        {.onEnter=startZaps, .onUpdate=updateZaps},
+        {},
+        {.onEnter=drawScores, .onUpdate=updateScores},
+        {},
+    };
+}
+
+// Game first, then runner. Returns false and skips the runner when the game handler moved to another phase.
+bool GameRunner::dispatch(GamePhase phase, PhaseHandler PhaseHandlers::* handler, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+{
+    const auto index = static_cast<uint8_t>(phase);
+    if(index >= GamePhaseCount)
     {
-        if(state.lastPhase != phase)
-        {
-            display.selectPlayers(state.playerPresence);
+        return false;
+    }
 
-            display.startDraw(22, 0, Display::Width - 22, 8);
-            display.printP("Player"_PSTR);
+    const auto current = state.phase;
 
-            display.startDraw(95 - Font::charAdvance * 4 / 2 + Font::charAdvance / 2, 0, Display::Width - 95, 8);
-            display.printP("Zaps"_PSTR);
+    const PhaseHandlers* const tables[] = {definition.phases, runnerPhases};
+    for(const auto table : tables)
+    {
+        if(!table)
+        {
+            continue;
+        }
 
-            uint8_t playerOrder[GameState::maxPlayerCount] = {};
-            uint8_t playerCount = 0;
-            for(int8_t x = 0; x < GameState::maxPlayerCount; x++)
-            {
-                if(state.isPlayerPresent(x))
-                {
-                    playerOrder[playerCount++] = x;
-                }
-            }
+        const auto function = readPgm(table[index].*handler);
+        if(!function)
+        {
+            continue;
+        }
 
-            sort(playerOrder, state.scores, playerCount);
+        function(state, display, input, ledController, soundController);
 
-            uint8_t ranking = 0;
-            for(int8_t x = 0; x < playerCount; x++)
-            {
-                const auto playerIndex = playerOrder[x];
-                const auto name = state.names[playerIndex];
-                const auto score = state.scores[playerIndex];
-
-                if(x == 0 || score != state.scores[playerOrder[x - 1]])
-                {
-                    ranking++;
-                }
-
-                display.startDraw(0, 8 + 2 * 8 * x, Display::Width - 0, 8);
-                display.print('#');
-                display.printSpace();
-                display.print('0' + ranking);
-                
-                display.startDraw(22 + 15, 8 + 2 * 8 * x, Font::charAdvance, 8);
-                display.print(name);
-
-                display.startDraw(95, 8 + 2 * 8 * x, Display::Width - 95, 8);
-                display.print_UL(score);
-            }
-        }
-    
-        if(state.phaseDuration > 10000)
+        if(state.phase != current)
         {
-            state.advance();
+            return false;
         }
     }
-    else if(phase == GameState::Phase::Finished)
+
+    return true;
+}
+
+void GameRunner::update(uint8_t ticks, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+{
+    if(state.gameIndex < 0)
     {
+        return;
+    }
+
+    state.ticks = ticks;
+    state.deltaTime = ticks * GameState::tickTime;
+    state.phaseDuration += state.deltaTime;
+
+    if(state.phase == state.lastPhase)
+    {
+        dispatch(state.phase, &PhaseHandlers::onUpdate, display, input, ledController, soundController);
     }
 
-    state.lastPhase = phase;
-}
\ No newline at end of file
+    // Phases only ever advance, so this walks through the phases skipped by their onEnter and stops.
+    // Running the edges in the same frame means Finished is entered before the app moves on.
+    while(state.phase != state.lastPhase)
+    {
+        const auto phase = state.phase;
+
+        if(state.lastPhase != GameState::Phase::None)
+        {
+            dispatch(state.lastPhase, &PhaseHandlers::onExit, display, input, ledController, soundController);
+        }
+
+        state.lastPhase = phase;
+        state.script = {};
+        state.runnerScript = {};
+
+        display.selectScreen(Display::Screen::Players);
+        display.clearRect();
+
+        dispatch(phase, &PhaseHandlers::onEnter, display, input, ledController, soundController);
+    }
+}
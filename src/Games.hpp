@@ -5,6 +5,7 @@
 
 #include "utils.hpp"
 #include "GameDefinition.hpp"
+#include "Coroutine.hpp"
 
 #include "games/pong.hpp"
 #include "games/reaction.hpp"
@@ -21,20 +22,7 @@ static constexpr uint8_t GameCount = sizeof(gameDefinitions) / sizeof(gameDefini
 
 struct GameState
 {
-    enum class Phase : int8_t
-    {
-        None = -1,
-        Init,
-        Title,
-        Demo,
-        Instructions,
-        Countdown,
-        Running,
-        Zaps,
-        GameResults,
-        Scores,
-        Finished
-    };
+    using Phase = GamePhase;
 
     enum class Difficulty : int8_t
     {
@@ -44,12 +32,20 @@ struct GameState
         Hard
     };
 
+    // The game advances in fixed ticks, deltaTime is always a whole number of them
+    static constexpr uint8_t tickTime = 4;
+
+    uint8_t ticks = {};
     uint8_t deltaTime = {};
     uint32_t phaseDuration = {};
 
     Phase phase;
     Phase lastPhase;
 
+    // Timelines of the current phase, restarted on every phase change
+    Coroutine script;
+    Coroutine runnerScript;
+
     union GameData
     {
         Pong::Data pong;
@@ -72,6 +68,9 @@ struct GameState
     
     Difficulty difficulty = Difficulty::None;
 
+    // The screens were cleared under the game, games that only draw what changed start over
+    bool redraw = false;
+
     void init()
     {
         phase = Phase::Init;
@@ -155,5 +154,8 @@ struct GameRunner
         state.gameIndex = index;
     }
 
-    void update(uint8_t deltaTime, Display& display, Input& input, LedController& ledController, SoundController& soundController);
+    void update(uint8_t ticks, Display& display, Input& input, LedController& ledController, SoundController& soundController);
+
+private:
+    bool dispatch(GamePhase phase, PhaseHandler PhaseHandlers::* handler, Display& display, Input& input, LedController& ledController, SoundController& soundController);
 };
\ No newline at end of file
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <stdint.h>
+#include "avr/pgmspace.h"
+
+#include "WS2812.hpp"
+#include "utils.hpp"
+
+namespace LedAnimation
+{
+    enum class Ease : uint8_t
+    {
+        Step,   // Hold the color until the next keyframe
+        Linear, // Fade towards the next keyframe
+    };
+
+    struct Keyframe
+    {
+        uint16_t time;
+        Rgb color;
+        Ease ease = Ease::Linear;
+    };
+
+    // Keyframes live in PROGMEM, sorted by time and starting at 0. The last one marks the length.
+    struct Track
+    {
+        const Keyframe* keys = nullptr;
+        uint8_t count = 0;
+        bool loop = false;
+        uint8_t spread = 0; // Time offset between consecutive leds, turns a pulse into a chase
+    };
+
+    template<uint8_t Count>
+    constexpr Track makeTrack(const Keyframe (&keys)[Count], bool loop = false, uint8_t spread = 0)
+    {
+        static_assert(Count > 0);
+        return {keys, Count, loop, spread};
+    }
+
+    enum class Blend : uint8_t
+    {
+        Replace,
+        Add,
+        Max,
+    };
+
+    inline uint8_t lerp(uint8_t from, uint8_t to, uint8_t t)
+    {
+        if(to >= from)
+        {
+            return from + ((static_cast<uint16_t>(to - from) * t) >> 8);
+        }
+
+        return from - ((static_cast<uint16_t>(from - to) * t) >> 8);
+    }
+
+    inline Rgb lerp(Rgb from, Rgb to, uint8_t t)
+    {
+        return {lerp(from.r, to.r, t), lerp(from.g, to.g, t), lerp(from.b, to.b, t)};
+    }
+
+    inline uint8_t addChannel(uint8_t a, uint8_t b)
+    {
+        const uint8_t sum = a + b;
+        return sum < a ? 255 : sum;
+    }
+
+    inline uint8_t maxChannel(uint8_t a, uint8_t b)
+    {
+        return a > b ? a : b;
+    }
+
+    inline Rgb blend(Rgb under, Rgb over, Blend mode)
+    {
+        if(mode == Blend::Add)
+        {
+            return {addChannel(under.r, over.r), addChannel(under.g, over.g), addChannel(under.b, over.b)};
+        }
+        else if(mode == Blend::Max)
+        {
+            return {maxChannel(under.r, over.r), maxChannel(under.g, over.g), maxChannel(under.b, over.b)};
+        }
+
+        return over;
+    }
+
+    inline uint16_t length(const Track& track)
+    {
+        return pgm_read_word(&track.keys[track.count - 1].time);
+    }
+
+    // Linear scan, tracks are a handful of keyframes long
+    inline Rgb sample(const Track& track, uint16_t time)
+    {
+        const auto end = length(track);
+        if(track.loop && end)
+        {
+            time %= end;
+        }
+
+        uint8_t index = 0;
+        while(index + 1 < track.count && pgm_read_word(&track.keys[index + 1].time) <= time)
+        {
+            index++;
+        }
+
+        const auto from = readPgm(track.keys[index]);
+        if(index + 1 >= track.count || from.ease == Ease::Step)
+        {
+            return from.color;
+        }
+
+        const auto to = readPgm(track.keys[index + 1]);
+        const uint8_t t = (static_cast<uint32_t>(time - from.time) << 8) / (to.time - from.time);
+
+        return lerp(from.color, to.color, t);
+    }
+
+    struct Layer
+    {
+        Track track;
+        uint16_t mask = 0;
+        uint16_t time = 0;
+        Blend blend = Blend::Replace;
+        Rgb color;
+
+        bool isActive() const
+        {
+            return track.keys != nullptr;
+        }
+    };
+
+    // Layers are advanced in fixed steps and stacked in order over the base pixels.
+    // Per frame it costs one sample per layer, or one per masked led for spread tracks.
+    template<uint8_t LayerCount>
+    class Animator
+    {
+        Layer layers[LayerCount] = {};
+        uint32_t lastStep = 0;
+
+    public:
+        static constexpr uint8_t stepTime = 8;
+
+        // After a long stall the animations resume where they were instead of jumping ahead
+        static constexpr uint8_t maxSteps = 4;
+
+        // track must point to PROGMEM
+        void play(uint8_t index, const Track& track, uint16_t mask, Blend blend = Blend::Replace)
+        {
+            auto& layer = layers[index];
+            layer.track = readPgm(track);
+            layer.mask = mask;
+            layer.time = 0;
+            layer.blend = blend;
+            layer.color = sample(layer.track, 0);
+        }
+
+        void stop(uint8_t index)
+        {
+            layers[index] = {};
+        }
+
+        bool isPlaying(uint8_t index) const
+        {
+            return layers[index].isActive();
+        }
+
+        // Returns true when an active layer moved or ended, the frame needs composing again
+        bool update(uint32_t now)
+        {
+            uint32_t steps = (now - lastStep) / stepTime;
+            if(steps > maxSteps)
+            {
+                steps = maxSteps;
+                lastStep = now;
+            }
+            else
+            {
+                lastStep += steps * stepTime;
+            }
+
+            if(steps == 0)
+            {
+                return false;
+            }
+
+            bool changed = false;
+            for(auto& layer : layers)
+            {
+                if(!layer.isActive())
+                {
+                    continue;
+                }
+
+                changed = true;
+
+                const auto end = length(layer.track);
+                layer.time += steps * stepTime;
+                if(layer.time >= end)
+                {
+                    if(!layer.track.loop || !end)
+                    {
+                        layer = {};
+                        continue;
+                    }
+
+                    layer.time %= end;
+                }
+
+                layer.color = sample(layer.track, layer.time);
+            }
+
+            return changed;
+        }
+
+        void compose(const Rgb* base, Rgb* out, uint8_t count) const
+        {
+            for(uint8_t x = 0; x < count; x++)
+            {
+                out[x] = base[x];
+            }
+
+            for(const auto& layer : layers)
+            {
+                if(!layer.isActive())
+                {
+                    continue;
+                }
+
+                for(uint8_t x = 0; x < count; x++)
+                {
+                    if((layer.mask & (1 << x)) == 0)
+                    {
+                        continue;
+                    }
+
+                    const auto color = layer.track.spread ? sample(layer.track, layer.time + x * layer.track.spread) : layer.color;
+                    out[x] = blend(out[x], color, layer.blend);
+                }
+            }
+        }
+    };
+}
@@ -1,30 +1,72 @@
 #pragma once
 
-#include <FastLED.h>
+#include <Arduino.h>
 
-#define LED_TYPE WS2812B
+#include "WS2812.hpp"
+#include "LedAnimation.hpp"
+#include "TimerSerial.hpp"
 
 struct LedController
 {
     using Color = uint32_t;
 
+    struct Stats
+    {
+        uint16_t shows = 0;
+        uint16_t skipped = 0;
+        uint16_t deferred = 0;
+        uint16_t forced = 0;
+
+        // Interrupts are masked once per pixel for 24 bits of 1.25us
+        static constexpr uint8_t maskedMicrosPerWindow = 24 * 5 / 4;
+    };
+
     static constexpr uint8_t LedPin = 2;
     static constexpr uint8_t LedCount = 10;
+    static constexpr uint16_t AllLeds = (1 << LedCount) - 1;
+
+    // Later layers are drawn over earlier ones
+    enum class Layer : uint8_t
+    {
+        Ambient,
+        Game,
+        Flash,
+
+        Count
+    };
+
+    static constexpr uint8_t Brightness = 20;
+
+    // D2 is PD2
+    using Strip = WS2812::Strip<LedPin, Brightness>;
+
+    Rgb leds[LedCount] = {};
+    bool dirty = true;
+
+    // leds with the animation layers on top, as last composed
+    Rgb frame[LedCount] = {};
+    bool pending = true;
 
-    CRGB leds[LedCount] = {};
+    LedAnimation::Animator<static_cast<uint8_t>(Layer::Count)> animator;
 
     static constexpr uint8_t showDelay = 12;
     uint32_t lastShowTime = 0;
 
-    constexpr static uint32_t fromRGB(uint8_t R, uint8_t G, uint8_t B)
+    // A frame waiting on the serial line longer than this goes out anyway,
+    // a pixel window only delays a pending bit by a fraction of its length
+    static constexpr uint8_t maxDeferDelay = 3 * showDelay;
+
+    Stats stats;
+
+    // 0xRRGGBB
+    constexpr static Color fromRGB(uint8_t R, uint8_t G, uint8_t B)
     {
-        return (static_cast<uint32_t>(R) << 0) | (static_cast<uint32_t>(G) << 8) | (static_cast<uint32_t>(B) << 16);
+        return (static_cast<uint32_t>(R) << 16) | (static_cast<uint32_t>(G) << 8) | (static_cast<uint32_t>(B) << 0);
     }
 
     void init()
     {
-        FastLED.addLeds<LED_TYPE, LedPin, GRB>(leds, LedCount).setCorrection(UncorrectedColor).setTemperature(UncorrectedTemperature);
-        FastLED.setBrightness(20);
+        Strip::init();
 
         display();
     }
@@ -40,31 +82,92 @@ struct LedController
             leds[1+x].r = (val & (1 << x)) ? 255 : 0;
         }
 
+        dirty = true;
         display();
     }
 
-    void set(uint8_t index, CRGB value)
+    void set(uint8_t index, Rgb value)
     {
-        leds[index] = value;
+        if(leds[index] != value)
+        {
+            leds[index] = value;
+            dirty = true;
+        }
     }
 
     void clear()
     {
         for(uint8_t x = 0; x < LedCount; x++)
         {
-            leds[x] = {};
+            set(x, {});
+        }
+    }
+
+    void play(Layer layer, const LedAnimation::Track& track, uint16_t mask = AllLeds, LedAnimation::Blend blend = LedAnimation::Blend::Replace)
+    {
+        animator.play(static_cast<uint8_t>(layer), track, mask, blend);
+    }
+
+    void stop(Layer layer)
+    {
+        animator.stop(static_cast<uint8_t>(layer));
+        dirty = true;
+    }
+
+    void compose()
+    {
+        Rgb composed[LedCount];
+        animator.compose(leds, composed, LedCount);
+
+        for(uint8_t x = 0; x < LedCount; x++)
+        {
+            if(frame[x] != composed[x])
+            {
+                frame[x] = composed[x];
+                pending = true;
+            }
         }
     }
 
     void display()
     {
         const auto now = millis();
-        if(now - lastShowTime < showDelay)
+        const auto sinceShow = now - lastShowTime;
+        if(sinceShow < showDelay)
         {
             return;
         }
 
+        if(animator.update(now) || dirty)
+        {
+            dirty = false;
+            compose();
+        }
+
+        if(!pending)
+        {
+            stats.skipped++;
+            lastShowTime = now;
+            return;
+        }
+
+        // Masking interrupts while a byte is on the sound module line would skew its bit timing.
+        // Buttons and handles are polled, the serial start bit is the only edge we capture.
+        if(!TimerSerial::isIdle())
+        {
+            if(sinceShow < maxDeferDelay)
+            {
+                stats.deferred++;
+                return;
+            }
+
+            stats.forced++;
+        }
+
         lastShowTime = now;
-        FastLED.show();
+        pending = false;
+        stats.shows++;
+
+        Strip::show(frame, LedCount);
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,23 @@
+#include "Memory.hpp"
+
+#include "debug.hpp"
+
+#ifdef __AVR__
+
+// Runs before the static data is set up and without a stack frame, so it paints
+// everything from the end of bss up to the initial stack pointer.
+extern "C" void paintStack() __attribute__((naked, used, section(".init3")));
+
+extern "C" void paintStack()
+{
+    if constexpr(debug::memory)
+    {
+        uint8_t* x = &Memory::__heap_start;
+        while(x < reinterpret_cast<uint8_t*>(SP))
+        {
+            *x++ = Memory::paint;
+        }
+    }
+}
+
+#endif
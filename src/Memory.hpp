@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+#include <Arduino.h>
+
+#include "str.hpp"
+
+// RAM left between the static data and the stack, which grows down towards it.
+// The gap is painted at boot (Memory.cpp), the deepest the stack went is where the paint stops.
+namespace Memory
+{
+    static constexpr uint8_t paint = 0xC5;
+
+    extern "C" uint8_t __data_start;
+    extern "C" uint8_t __data_end;
+    extern "C" uint8_t __bss_start;
+    extern "C" uint8_t __bss_end;
+    extern "C" uint8_t __heap_start;
+    extern "C" char* __brkval;
+
+    // Below this much untouched stack a report flags the RAM as low
+    static constexpr uint16_t lowMargin = 128;
+
+    inline uint8_t* heapEnd()
+    {
+        return __brkval ? reinterpret_cast<uint8_t*>(__brkval) : &__heap_start;
+    }
+
+    inline uint16_t getStaticSize()
+    {
+        return (&__data_end - &__data_start) + (&__bss_end - &__bss_start);
+    }
+
+    inline uint16_t getHeapSize()
+    {
+        return heapEnd() - &__heap_start;
+    }
+
+    inline uint16_t getFreeNow()
+    {
+        uint8_t top;
+        return &top - heapEnd();
+    }
+
+    // Untouched paint above the heap, the smallest free stack seen since boot
+    inline uint16_t getFreeMin()
+    {
+        const uint8_t* end = reinterpret_cast<const uint8_t*>(SP);
+
+        uint16_t free = 0;
+        for(const uint8_t* x = heapEnd(); x < end && *x == paint; x++)
+        {
+            free++;
+        }
+
+        return free;
+    }
+
+    inline void printEntry(Print& out, const char* name, uint16_t size)
+    {
+        out.print(reinterpret_cast<const __FlashStringHelper*>(name));
+        out.print(' ');
+        out.println(size);
+    }
+
+    inline void dump(Print& out)
+    {
+        const auto freeMin = getFreeMin();
+
+        printEntry(out, "static"_PSTR, getStaticSize());
+        printEntry(out, "heap"_PSTR, getHeapSize());
+        printEntry(out, "free"_PSTR, getFreeNow());
+        printEntry(out, "free min"_PSTR, freeMin);
+
+        if(freeMin < lowMargin)
+        {
+            out.println(F("RAM LOW"));
+        }
+    }
+}
@@ -3,7 +3,8 @@
 #include "utils.hpp"
 #include "input.hpp"
 #include "Display.hpp"
-#include "Settings.hpp"
+#include "settings.hpp"
+#include "Tuning.hpp"
 #include "LedController.hpp"
 
 #include "Games.hpp"
@@ -14,6 +15,7 @@ enum Menus : uint8_t
     SelectGame,
     DifficultySelect,
     Settings,
+    Parameters,
     Paused,
 
     Count
@@ -26,7 +28,9 @@ enum MenuAction : uint8_t
     Resume,
     ExitToMenu,
     Traitor,
-    DemoZaps
+    DemoZaps,
+    ShowStatistics,
+    ResetTuning
 };
 
 enum EntryType : uint8_t
@@ -35,7 +39,8 @@ enum EntryType : uint8_t
     Action,
     GameSelect,
     Difficulty,
-    Setting
+    Setting,
+    Parameter
 };
 
 class MenuEntry
@@ -109,7 +114,8 @@ PROGMEM static constexpr MenuEntry MenuEntries_Main[] = {
     {"Play"_PSTR, MenuAction::Play},
     {"Select Game"_PSTR, Menus::SelectGame},
     {"Settings"_PSTR, Menus::Settings},
-    {"Demo Zaps"_PSTR, MenuAction::DemoZaps}
+    {"Demo Zaps"_PSTR, MenuAction::DemoZaps},
+    {"Statistics"_PSTR, MenuAction::ShowStatistics}
 };
 
 PROGMEM static constexpr MenuEntry MenuEntries_DifficultySelect[]
@@ -150,10 +156,11 @@ constexpr const auto& buildSettingsMenu()
 {    
     return []<auto... Xs>(seq<Xs...>) -> const auto&
     {
-        PROGMEM static constexpr MenuEntry entries[SettingCount + 1] =
+        PROGMEM static constexpr MenuEntry entries[SettingCount + 2] =
         {
             {"Back"_PSTR, Menus::Main},
-            MenuEntry{settingDefinitions[Xs].name, EntryType::Setting, Xs}...
+            MenuEntry{settingDefinitions[Xs].name, EntryType::Setting, Xs}...,
+            {"Tuning"_PSTR, Menus::Parameters}
         };
 
         return entries;
@@ -163,6 +170,24 @@ constexpr const auto& buildSettingsMenu()
 
 constexpr const auto& MenuEntries_Settings = buildSettingsMenu();
 
+constexpr const auto& buildParametersMenu()
+{    
+    return []<auto... Xs>(seq<Xs...>) -> const auto&
+    {
+        PROGMEM static constexpr MenuEntry entries[TuningCount + 2] =
+        {
+            {"Back"_PSTR, Menus::Settings},
+            MenuEntry{tuningDefinitions[Xs].name, EntryType::Parameter, Xs}...,
+            {"Reset defaults"_PSTR, MenuAction::ResetTuning}
+        };
+
+        return entries;
+    }
+    (gen_seq<TuningCount>{});
+}
+
+constexpr const auto& MenuEntries_Parameters = buildParametersMenu();
+
 #define MENU_LIST_ENTRY(menu) {MenuEntries_ ## menu, sizeof(MenuEntries_  ## menu) / sizeof(MenuEntries_ ## menu[0])}
 
 PROGMEM static constexpr MenuDefinition menuDefinitions[static_cast<uint8_t>(Menus::Count)]
@@ -171,6 +196,7 @@ PROGMEM static constexpr MenuDefinition menuDefinitions[static_cast<uint8_t>(Men
     MENU_LIST_ENTRY(SelectGame),
     MENU_LIST_ENTRY(DifficultySelect),
     MENU_LIST_ENTRY(Settings),
+    MENU_LIST_ENTRY(Parameters),
     MENU_LIST_ENTRY(Paused),
 };
 
@@ -187,6 +213,10 @@ public:
 
     uint8_t currentIndex = 0;
 
+    // First entry on screen, longer menus scroll to keep the selection visible
+    uint8_t scroll = 0;
+    static constexpr uint8_t visibleRows = Display::Height / Font::charHeight;
+
     static constexpr uint8_t indicatorZoneWidth = Font::charWidth + 3;
     static constexpr uint8_t textZoneWidth = Display::Width - indicatorZoneWidth;
 
@@ -199,9 +229,9 @@ public:
         display.selectMenu();
         display.clearRect();
 
-        for(int x = 0; x < definition.entryCount; x++)
+        for(int x = scroll; x < definition.entryCount && x < scroll + visibleRows; x++)
         {
-            display.startDraw(0, x * Font::charHeight);
+            display.startDraw(0, (x - scroll) * Font::charHeight);
 
             display.print(x == currentIndex ? '>' : ' ');
 
@@ -223,6 +253,11 @@ public:
 
         currentIndex--;
         needsRedraw = true;
+
+        if(currentIndex < scroll)
+        {
+            scroll = currentIndex;
+        }
     }
 
     void moveDown()
@@ -234,6 +269,11 @@ public:
         
         currentIndex++;
         needsRedraw = true;
+
+        if(currentIndex >= scroll + visibleRows)
+        {
+            scroll = currentIndex - visibleRows + 1;
+        }
     }
 
     const MenuEntry* onSelect()
@@ -275,6 +315,7 @@ public:
     void setMenu(Menus menu)
     {
         currentIndex = 0;
+        scroll = 0;
         needsRedraw = true;
         definition = getMenu(menu);
     }
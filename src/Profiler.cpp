@@ -0,0 +1,10 @@
+#include "Profiler.hpp"
+
+#include <avr/interrupt.h>
+
+#if PROFILER
+ISR(TIMER1_OVF_vect)
+{
+    Profiler<true>::overflows++;
+}
+#endif
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "debug.hpp"
+
+enum class ProfileZone : uint8_t
+{
+    Other,
+    Input,
+    Sound,
+    Game,
+    Display,
+    Led,
+    Mux,
+
+    Count
+};
+
+// Cycles spent per zone and per frame, counted by Timer1 at F_CPU.
+// Zones nest and are exclusive: time goes to the innermost open zone, Other gets what is outside any.
+// Only the specialisation for Enabled = true carries any state.
+template<bool Enabled>
+class Profiler
+{
+public:
+    void init() {}
+    void enter(ProfileZone) {}
+    void exit() {}
+    void beginFrame() {}
+    void endFrame() {}
+    void dump(Print&) {}
+
+    template<typename Display>
+    void drawOverlay(Display&) const {}
+};
+
+template<>
+class Profiler<true>
+{
+public:
+    // Draw the averages on the menu screen during games
+    static constexpr bool overlay = true;
+
+    // Per frame binary records on the hardware UART:
+    // 0xA5 0x5A, frame number, then one little endian uint16 per zone in microseconds (saturated)
+    static constexpr bool stream = true;
+
+    static constexpr uint8_t zoneCount = static_cast<uint8_t>(ProfileZone::Count);
+    static constexpr uint8_t maxDepth = 6;
+
+    // Incremented by the Timer1 overflow vector in Profiler.cpp
+    static inline volatile uint16_t overflows = 0;
+
+    struct Summary
+    {
+        uint32_t min = -1;
+        uint32_t max = 0;
+        uint32_t total = 0;
+
+        void add(uint32_t value)
+        {
+            if(value < min)
+            {
+                min = value;
+            }
+            if(value > max)
+            {
+                max = value;
+            }
+
+            total += value;
+        }
+    };
+
+private:
+    ProfileZone stack[maxDepth] = {};
+    uint8_t depth = 0;
+    uint32_t last = 0;
+
+    uint32_t frame[zoneCount] = {};
+    uint8_t frameNumber = 0;
+
+    Summary zones[zoneCount];
+    Summary frames;
+    uint16_t frameCount = 0;
+
+    static constexpr PROGMEM char names[zoneCount + 1] = {'O', 'I', 'S', 'G', 'D', 'L', 'M', 'F'};
+
+    static uint32_t cycles()
+    {
+        uint16_t low;
+        uint16_t high;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            low = TCNT1;
+            high = overflows;
+
+            // Wrapped after the interrupts were masked, the vector hasn't run yet
+            if((TIFR1 & _BV(TOV1)) && low < 0x8000)
+            {
+                high++;
+            }
+        }
+
+        return (static_cast<uint32_t>(high) << 16) | low;
+    }
+
+    void charge()
+    {
+        const auto now = cycles();
+        // Levels nested past maxDepth aren't stored, they keep charging the deepest stored zone
+        const auto stored = depth < maxDepth ? depth : maxDepth;
+        const auto zone = stored ? stack[stored - 1] : ProfileZone::Other;
+        frame[static_cast<uint8_t>(zone)] += now - last;
+        last = now;
+    }
+
+    static uint16_t toMicros(uint32_t cycles)
+    {
+        const uint32_t micros = cycles / (F_CPU / 1000000);
+        return micros > 0xFFFF ? 0xFFFF : micros;
+    }
+
+    template<typename Display>
+    static void printTenths(Display& display, char label, uint32_t cycles)
+    {
+        display.print(label);
+        display.print_UL(cycles / (F_CPU / 10000));
+        display.printSpace();
+    }
+
+public:
+    void init()
+    {
+        TCCR1A = 0;
+        TCCR1B = _BV(CS10);
+        TCNT1 = 0;
+        TIFR1 = _BV(TOV1);
+        TIMSK1 = _BV(TOIE1);
+    }
+
+    void enter(ProfileZone zone)
+    {
+        charge();
+
+        if(depth < maxDepth)
+        {
+            stack[depth] = zone;
+        }
+        depth++;
+    }
+
+    void exit()
+    {
+        charge();
+        depth--;
+    }
+
+    void beginFrame()
+    {
+        for(auto& cycles : frame)
+        {
+            cycles = 0;
+        }
+
+        depth = 0;
+        last = cycles();
+    }
+
+    void endFrame()
+    {
+        charge();
+
+        uint32_t total = 0;
+        for(uint8_t x = 0; x < zoneCount; x++)
+        {
+            zones[x].add(frame[x]);
+            total += frame[x];
+        }
+
+        frames.add(total);
+        frameCount++;
+        frameNumber++;
+
+        if constexpr(stream)
+        {
+            Serial.write(0xA5);
+            Serial.write(0x5A);
+            Serial.write(frameNumber);
+            for(const auto cycles : frame)
+            {
+                const auto micros = toMicros(cycles);
+                Serial.write(micros & 0xFF);
+                Serial.write(micros >> 8);
+            }
+        }
+    }
+
+    // Min/avg/max per zone in microseconds since the last dump, then starts a new window.
+    // Nothing is printed while streaming, text would break the binary records.
+    void dump(Print& out)
+    {
+        if(frameCount == 0)
+        {
+            return;
+        }
+
+        for(uint8_t x = 0; x <= zoneCount && !stream; x++)
+        {
+            const auto& summary = x < zoneCount ? zones[x] : frames;
+
+            out.print(static_cast<char>(pgm_read_byte(&names[x])));
+            out.print(' ');
+            out.print(toMicros(summary.min));
+            out.print(' ');
+            out.print(toMicros(summary.total / frameCount));
+            out.print(' ');
+            out.println(toMicros(summary.max));
+        }
+
+        for(auto& summary : zones)
+        {
+            summary = {};
+        }
+        frames = {};
+        frameCount = 0;
+    }
+
+    // Averages in tenths of a millisecond on the two bottom lines of the menu screen
+    template<typename Display>
+    void drawOverlay(Display& display) const
+    {
+        if(!overlay || frameCount == 0)
+        {
+            return;
+        }
+
+        const auto average = [&](ProfileZone zone)
+        {
+            return zones[static_cast<uint8_t>(zone)].total / frameCount;
+        };
+
+        display.selectMenu();
+        display.clearRect(0, Display::Height - 16, Display::Width, 16);
+
+        display.startDraw(0, Display::Height - 16, Display::Width, 8);
+        printTenths(display, 'I', average(ProfileZone::Input));
+        printTenths(display, 'S', average(ProfileZone::Sound));
+        printTenths(display, 'G', average(ProfileZone::Game));
+        printTenths(display, 'D', average(ProfileZone::Display));
+
+        display.startDraw(0, Display::Height - 8, Display::Width, 8);
+        printTenths(display, 'L', average(ProfileZone::Led));
+        printTenths(display, 'M', average(ProfileZone::Mux));
+        printTenths(display, 'F', frames.total / frameCount);
+        printTenths(display, 'P', frames.max);
+    }
+};
+
+inline Profiler<debug::profiler> profiler;
+
+// Charges the enclosing scope to a zone, compiles to nothing when the profiler is off
+class ProfileScope
+{
+public:
+    ProfileScope(ProfileZone zone)
+    {
+        profiler.enter(zone);
+    }
+
+    ~ProfileScope()
+    {
+        profiler.exit();
+    }
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <stdint.h>
+#include <Arduino.h>
+
+// Game randomness. random() from the core runs a 32-bit generator and a 32-bit modulo for every
+// call, this is a 16-bit xorshift (7, 9, 8, full period over the non zero states) and ranges are
+// mapped by a multiply and a shift, redrawing the few values that would favour some results.
+namespace Random
+{
+    inline uint16_t state = 1;
+
+    inline uint16_t next()
+    {
+        state ^= state << 7;
+        state ^= state >> 9;
+        state ^= state << 8;
+        return state;
+    }
+
+    inline uint8_t byte()
+    {
+        return next() >> 8;
+    }
+
+    // [0, bound), 0 when bound is 0
+    inline uint8_t below(uint8_t bound)
+    {
+        uint16_t product = static_cast<uint16_t>(byte()) * bound;
+        uint8_t low = product;
+
+        if(low < bound)
+        {
+            const uint8_t threshold = static_cast<uint8_t>(-bound) % bound;
+            while(low < threshold)
+            {
+                product = static_cast<uint16_t>(byte()) * bound;
+                low = product;
+            }
+        }
+
+        return product >> 8;
+    }
+
+    inline uint16_t below16(uint16_t bound)
+    {
+        uint32_t product = static_cast<uint32_t>(next()) * bound;
+        uint16_t low = product;
+
+        if(low < bound)
+        {
+            const uint16_t threshold = static_cast<uint16_t>(-bound) % bound;
+            while(low < threshold)
+            {
+                product = static_cast<uint32_t>(next()) * bound;
+                low = product;
+            }
+        }
+
+        return product >> 16;
+    }
+
+    // Only for the rare long spans like game durations in ms, the 64-bit multiply is slow
+    inline uint32_t below32(uint32_t bound)
+    {
+        if(bound <= UINT16_MAX)
+        {
+            return below16(bound);
+        }
+
+        const auto draw = []()
+        {
+            return static_cast<uint32_t>(next()) << 16 | next();
+        };
+
+        uint64_t product = static_cast<uint64_t>(draw()) * bound;
+        uint32_t low = product;
+
+        if(low < bound)
+        {
+            const uint32_t threshold = static_cast<uint32_t>(-bound) % bound;
+            while(low < threshold)
+            {
+                product = static_cast<uint64_t>(draw()) * bound;
+                low = product;
+            }
+        }
+
+        return product >> 32;
+    }
+
+    // [low, high) like random(low, high), low when the range is empty
+    inline uint8_t range(uint8_t low, uint8_t high)
+    {
+        return high > low ? low + below(high - low) : low;
+    }
+
+    inline uint32_t range32(uint32_t low, uint32_t high)
+    {
+        return high > low ? low + below32(high - low) : low;
+    }
+
+    inline bool binary()
+    {
+        return next() & 0x8000;
+    }
+
+    // Index of one of the set bits of mask, 0 when there is none
+    inline uint8_t member(uint8_t mask)
+    {
+        uint8_t count = 0;
+        for(uint8_t bits = mask; bits; bits &= bits - 1)
+        {
+            count++;
+        }
+
+        for(uint8_t skip = below(count), x = 0; x < 8; x++)
+        {
+            if((mask & (1 << x)) && skip-- == 0)
+            {
+                return x;
+            }
+        }
+
+        return 0;
+    }
+
+    inline void shuffle(uint8_t* values, uint8_t count)
+    {
+        for(uint8_t x = count; x > 1; x--)
+        {
+            const auto y = below(x);
+            const auto temp = values[x - 1];
+            values[x - 1] = values[y];
+            values[y] = temp;
+        }
+    }
+
+    // count distinct values of [0, total) in increasing order, one draw per value of the range
+    inline void sample(uint8_t* values, uint8_t count, uint8_t total)
+    {
+        for(uint8_t x = 0; x < total && count; x++)
+        {
+            if(below(total - x) < count)
+            {
+                *values++ = x;
+                count--;
+            }
+        }
+    }
+
+    // The whole generator state, for replays
+    inline uint16_t save()
+    {
+        return state;
+    }
+
+    inline void restore(uint16_t saved)
+    {
+        state = saved ? saved : 1;
+    }
+
+    inline void seed(uint32_t seed)
+    {
+        restore(seed ^ (seed >> 16));
+    }
+
+    // Folds noise into the state, the draw spreads its low bits over the whole word
+    inline void stir(uint16_t noise)
+    {
+        restore(state ^ noise);
+        next();
+    }
+
+    // Only a quick first seed, the box keeps stirring ADC noise and press timings while players
+    // join (see App::updateJoining), well before the first game draws anything
+    inline void init()
+    {
+        uint32_t seed = 0;
+        for(uint8_t x = 0; x < sizeof(seed) * 8 / 2; x++)
+        {
+            seed <<= 2;
+            seed |= analogRead(A6) & 0x03;
+        }
+
+        Random::seed(seed);
+    }
+}
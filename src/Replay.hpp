@@ -0,0 +1,223 @@
+#pragma once
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <avr/eeprom.h>
+
+#include "debug.hpp"
+#include "input.hpp"
+#include "Storage.hpp"
+#include "Random.hpp"
+
+enum class ReplayMode : uint8_t
+{
+    Off,
+    Record,
+    Play
+};
+
+// Whole sessions reproduced from the random state and the input of every frame. Game time only moves by
+// ticks, so the same random state, ticks and debounced presses give the same session on the board and in
+// the native build. Recordings live in EEPROM, read one back with
+//   avrdude ... -U eeprom:r:session.eep:r
+// and play it in the host build with program --eeprom session.eep (see [env:native_replay]).
+// The random state is the one when joining ends, it keeps being stirred until then.
+//
+// Stream after the header, 0xFF (erased EEPROM) ends it:
+//   0nnnnnnn         n + 1 frames of one tick without input change
+//   100ttttt         one frame of t + 1 ticks without input change
+//   110ttttt p l     one frame of t + 1 ticks, then the pressed and long pressed inputs
+template<ReplayMode Mode>
+class Replay
+{
+public:
+    void begin() {}
+    void seed() {}
+    void frame(uint8_t&, Input&) {}
+    void flush() {}
+};
+
+namespace ReplayFormat
+{
+    static constexpr uint8_t version = 3;
+
+    static constexpr uint8_t end = 0xFF;
+    static constexpr uint8_t maxRun = 0x80;
+    static constexpr uint8_t ticksFlag = 0x80;
+    static constexpr uint8_t inputFlag = 0x40;
+    static constexpr uint8_t ticksMask = 0x1F;
+
+    static constexpr uint16_t headerSize = 1 + sizeof(uint16_t);
+
+    inline uint8_t* address(uint16_t offset)
+    {
+        return reinterpret_cast<uint8_t*>(Storage::replayAddress + offset);
+    }
+}
+
+template<>
+class Replay<ReplayMode::Record>
+{
+    uint16_t offset = ReplayFormat::headerSize;
+    uint8_t run = 0;
+    uint8_t pressed = 0;
+    uint8_t longPressed = 0;
+    bool full = false;
+
+    // Each write is followed by an end marker so a shorter session doesn't run into an older one.
+    // Recording stops for good at the first write that doesn't fit, the start of the session is the
+    // part worth keeping and a smaller write after it would leave a gap in the stream.
+    void write(const uint8_t* bytes, uint8_t count)
+    {
+        if(full || offset + count + 1 > Storage::replaySize)
+        {
+            full = true;
+            return;
+        }
+
+        eeprom_update_block(bytes, ReplayFormat::address(offset), count);
+        offset += count;
+        eeprom_update_byte(ReplayFormat::address(offset), ReplayFormat::end);
+    }
+
+    void flushRun()
+    {
+        if(run)
+        {
+            const uint8_t byte = run - 1;
+            write(&byte, 1);
+            run = 0;
+        }
+    }
+
+public:
+    void begin()
+    {
+        eeprom_update_byte(ReplayFormat::address(0), ReplayFormat::version);
+        seed();
+        eeprom_update_byte(ReplayFormat::address(offset), ReplayFormat::end);
+    }
+
+    void seed()
+    {
+        eeprom_update_word(reinterpret_cast<uint16_t*>(ReplayFormat::address(1)), Random::save());
+    }
+
+    void frame(uint8_t& ticks, Input& input)
+    {
+        const bool changed = input.currentInputsPress != pressed || input.currentInputsLongPress != longPressed;
+        if(ticks == 1 && !changed)
+        {
+            if(++run == ReplayFormat::maxRun)
+            {
+                flushRun();
+            }
+            return;
+        }
+
+        flushRun();
+
+        pressed = input.currentInputsPress;
+        longPressed = input.currentInputsLongPress;
+
+        const uint8_t bytes[] = {
+            static_cast<uint8_t>(ReplayFormat::ticksFlag | (changed ? ReplayFormat::inputFlag : 0) | (ticks - 1)),
+            pressed,
+            longPressed
+        };
+        write(bytes, changed ? 3 : 1);
+    }
+
+    // Pending idle frames are only written by the next input change, a reset before it would lose them
+    void flush()
+    {
+        flushRun();
+    }
+};
+
+template<>
+class Replay<ReplayMode::Play>
+{
+    uint16_t offset = ReplayFormat::headerSize;
+    uint8_t run = 0;
+    uint8_t pressed = 0;
+    uint8_t longPressed = 0;
+    bool playing = false;
+
+    uint8_t read()
+    {
+        if(offset >= Storage::replaySize)
+        {
+            return ReplayFormat::end;
+        }
+
+        return eeprom_read_byte(ReplayFormat::address(offset++));
+    }
+
+public:
+    // Without a recording the session runs live
+    void begin()
+    {
+        playing = eeprom_read_byte(ReplayFormat::address(0)) == ReplayFormat::version;
+    }
+
+    void seed()
+    {
+        if(playing)
+        {
+            Random::restore(eeprom_read_word(reinterpret_cast<const uint16_t*>(ReplayFormat::address(1))));
+        }
+    }
+
+    // Once the recording ends the buttons take over again
+    void frame(uint8_t& ticks, Input& input)
+    {
+        if(!playing)
+        {
+            return;
+        }
+
+        if(run)
+        {
+            run--;
+            ticks = 1;
+        }
+        else
+        {
+            const uint8_t byte = read();
+            if(byte == ReplayFormat::end)
+            {
+                playing = false;
+
+                if constexpr(debug::serial)
+                {
+                    Serial.println(F("replay done"));
+                }
+                return;
+            }
+
+            if(byte & ReplayFormat::ticksFlag)
+            {
+                ticks = (byte & ReplayFormat::ticksMask) + 1;
+
+                if(byte & ReplayFormat::inputFlag)
+                {
+                    pressed = read();
+                    longPressed = read();
+                }
+            }
+            else
+            {
+                run = byte;
+                ticks = 1;
+            }
+        }
+
+        input.currentInputsPress = pressed;
+        input.currentInputsLongPress = longPressed;
+    }
+
+    void flush() {}
+};
+
+inline Replay<static_cast<ReplayMode>(debug::replay)> replay;
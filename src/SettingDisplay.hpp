@@ -3,10 +3,11 @@
 #include "utils.hpp"
 #include "input.hpp"
 #include "Display.hpp"
-#include "Settings.hpp"
+#include "settings.hpp"
 #include "LedController.hpp"
 
 #include "settings.hpp"
+#include "Tuning.hpp"
 
 class SettingDisplay
 {
@@ -14,8 +15,18 @@ public:
     bool needsRedraw = false;
     SettingDefinition definition = {};
 
+    // Edited here and written back on save, tunings have no RAM copy to point at
+    int16_t value = 0;
+    TuningId tuning = TuningId::Count;
+    TuningDefinition::Unit unit = TuningDefinition::Unit::None;
+
     static constexpr auto halfPressColor = LedController::fromRGB(0, 255 / 2, 0);
 
+    // Each press steps the value, only the one it settles on gets written
+    static constexpr uint16_t saveDelay = 3000;
+    uint32_t lastChange = 0;
+    bool unsaved = false;
+
     void redraw(Display& display)
     {
         needsRedraw = false;
@@ -32,16 +43,26 @@ public:
             display.SI2C.write(0b11111111);
 
             const auto& number = definition.number;
-            auto& value= *number.value;
 
             const uint8_t width = 80;
-            const auto filledWidth = (value - number.min) * width / number.max;
+            const auto filledWidth = static_cast<int32_t>(value - number.min) * width / (number.max - number.min);
             for(uint8_t x = 0; x < width; x++)
             {
                 const bool isFilled = x < filledWidth;
                 display.SI2C.write(isFilled ? 0b00111100 : 0);
             }
             display.SI2C.write(0b11111111);
+
+            display.startDraw(10, Font::charHeight * 3, 100, Font::charHeight);
+            display.print_L(value);
+            if(unit == TuningDefinition::Unit::Deciseconds)
+            {
+                display.printP("00ms"_PSTR);
+            }
+            else if(unit == TuningDefinition::Unit::Seconds)
+            {
+                display.print('s');
+            }
         }
     }
 
@@ -53,13 +74,14 @@ public:
         if(type == SettingDefinition::Type::Number)
         {
             const auto& number = definition.number;
-            auto& value = *number.value;
             value += number.increment; 
             if(value > number.max)
             {
                 value = number.max;
             }
         }
+
+        onValueChange();
     }
 
     void onDown()
@@ -70,18 +92,39 @@ public:
         if(type == SettingDefinition::Type::Number)
         {
             const auto& number = definition.number;
-            auto& value = *number.value;
             value -= number.increment; 
             if(value < number.min)
             {
                 value = number.min;
             }
         }
+
+        onValueChange();
     }
 
     void onValueChange()
     {
-        
+        if(!isTuning())
+        {
+            *definition.number.value = value;
+        }
+
+        lastChange = millis();
+        unsaved = true;
+    }
+
+    void save()
+    {
+        unsaved = false;
+
+        if(isTuning())
+        {
+            Tuning::set(tuning, value);
+        }
+        else
+        {
+            saveSettings();
+        }
     }
 
     void updateLeds(Input& input, LedController& ledController)
@@ -109,6 +152,24 @@ public:
     {
         needsRedraw = true;
         definition = readPgm(settingDefinitions[static_cast<uint8_t>(id)]);
+        value = *definition.number.value;
+        tuning = TuningId::Count;
+        unit = TuningDefinition::Unit::None;
+    }
+
+    void setTuning(TuningId id)
+    {
+        needsRedraw = true;
+        const auto tuningDefinition = readPgm(tuningDefinitions[static_cast<uint8_t>(id)]);
+        definition = tuningDefinition;
+        value = Tuning::getRaw(id);
+        tuning = id;
+        unit = tuningDefinition.unit;
+    }
+
+    bool isTuning() const
+    {
+        return tuning != TuningId::Count;
     }
     
     bool update(Display& display, Input& input, LedController& ledController)
@@ -130,9 +191,19 @@ public:
         }
         else if(input.isNewPressed(Input::Button::MenuSelect))
         {
+            if(unsaved)
+            {
+                save();
+            }
+
             return true;
         }
 
+        if(unsaved && millis() - lastChange >= saveDelay)
+        {
+            save();
+        }
+
         return false;
     }
 };
\ No newline at end of file
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <stdint.h>
+#include <Arduino.h>
+
+#include "DFPlayer.hpp"
+#include "TimerSerial.hpp"
+#include "str.hpp"
+#include "debug.hpp"
+
+// Timings of the sound pipeline per command type, from the request being issued to
+// its frame leaving the UART, to the module's ack and to the audible change reported
+// by the DFPlayer BUSY pin (low while playing).
+// Only the specialisation for Enabled = true carries any state.
+template<bool Enabled>
+class SoundLatency
+{
+public:
+    void init() {}
+    void onSent(DFPlayer::Command, uint32_t) {}
+    void onAck(DFPlayer::Command, uint32_t, uint32_t) {}
+    void update(uint32_t) {}
+    void dump(Print&) const {}
+};
+
+template<>
+class SoundLatency<true>
+{
+public:
+    // Without the BUSY output on A0 the audible stage isn't measured, see debug::soundBusyPin
+    static constexpr bool hasBusyPin = debug::soundBusyPin;
+    static constexpr uint8_t busyMask = _BV(0);
+
+    enum Stage : uint8_t
+    {
+        Wire,
+        Ack,
+        Audible,
+
+        StageCount
+    };
+
+    enum Type : uint8_t
+    {
+        Play,
+        Pause,
+        Resume,
+        Stop,
+        Volume,
+        Loop,
+        Other,
+
+        TypeCount
+    };
+
+    static constexpr uint8_t bucketCount = 8;
+
+    struct Timing
+    {
+        uint16_t min = -1;
+        uint16_t max = 0;
+        uint32_t total = 0;
+        uint16_t count = 0;
+
+        void add(uint16_t value)
+        {
+            if(value < min)
+            {
+                min = value;
+            }
+            if(value > max)
+            {
+                max = value;
+            }
+
+            total += value;
+            count++;
+        }
+    };
+
+    struct TypeStats
+    {
+        Timing stages[StageCount];
+
+        // log2 buckets of the issue to ack (or audible) time: 0-1, 2-3, 4-7 ... 128+ ms
+        uint8_t histogram[bucketCount] = {};
+    };
+
+private:
+    TypeStats stats[TypeCount];
+
+    struct Pending
+    {
+        Type type;
+        uint32_t issuedAt;
+        bool active;
+    };
+
+    Pending wire = {};
+    Pending audible = {};
+    bool expectBusy = false;
+
+    static constexpr uint16_t audibleTimeout = 3000;
+
+    static Type typeOf(DFPlayer::Command code)
+    {
+        switch(code)
+        {
+            case DFPlayer::Command::Play:
+                return Type::Play;
+            case DFPlayer::Command::Pause:
+                return Type::Pause;
+            case DFPlayer::Command::Resume:
+                return Type::Resume;
+            case DFPlayer::Command::Stop:
+                return Type::Stop;
+            case DFPlayer::Command::Volume:
+                return Type::Volume;
+            case DFPlayer::Command::SingleLoop:
+                return Type::Loop;
+            default:
+                return Type::Other;
+        }
+    }
+
+    void addToHistogram(Type type, uint16_t value)
+    {
+        uint8_t bucket = 0;
+        while(value > 1 && bucket < bucketCount - 1)
+        {
+            value >>= 1;
+            bucket++;
+        }
+
+        auto& count = stats[type].histogram[bucket];
+        if(count < 0xFF)
+        {
+            count++;
+        }
+    }
+
+    static bool isBusy()
+    {
+        return !(PINC & busyMask);
+    }
+
+public:
+    void init()
+    {
+        if constexpr(hasBusyPin)
+        {
+            DDRC &= ~busyMask;
+            PORTC |= busyMask;
+        }
+    }
+
+    void onSent(DFPlayer::Command code, uint32_t issuedAt)
+    {
+        wire = {typeOf(code), issuedAt, true};
+    }
+
+    void onAck(DFPlayer::Command code, uint32_t issuedAt, uint32_t now)
+    {
+        const auto type = typeOf(code);
+        const uint16_t ackLatency = now - issuedAt;
+        stats[type].stages[Stage::Ack].add(ackLatency);
+
+        const bool changesState = type == Type::Play || type == Type::Pause || type == Type::Resume || type == Type::Stop;
+        if(hasBusyPin && changesState)
+        {
+            audible = {type, issuedAt, true};
+            expectBusy = type == Type::Play || type == Type::Resume;
+        }
+        else
+        {
+            addToHistogram(type, ackLatency);
+        }
+    }
+
+    void update(uint32_t now)
+    {
+        if(wire.active && !TimerSerial::isSending())
+        {
+            wire.active = false;
+            stats[wire.type].stages[Stage::Wire].add(now - wire.issuedAt);
+        }
+
+        if(!audible.active)
+        {
+            return;
+        }
+
+        const uint16_t audibleLatency = now - audible.issuedAt;
+        if(isBusy() == expectBusy)
+        {
+            audible.active = false;
+            stats[audible.type].stages[Stage::Audible].add(audibleLatency);
+            addToHistogram(audible.type, audibleLatency);
+        }
+        else if(audibleLatency > audibleTimeout)
+        {
+            audible.active = false;
+        }
+    }
+
+    void dump(Print& out) const
+    {
+        static constexpr const char* typeNames[] =
+        {
+            "play"_PSTR,
+            "pause"_PSTR,
+            "resume"_PSTR,
+            "stop"_PSTR,
+            "volume"_PSTR,
+            "loop"_PSTR,
+            "other"_PSTR,
+        };
+
+        static constexpr const char* stageNames[] =
+        {
+            " wire"_PSTR,
+            " ack"_PSTR,
+            " audible"_PSTR,
+        };
+
+        out.print(F("sound latency ms (min/avg/max)\n"));
+
+        for(uint8_t type = 0; type < TypeCount; type++)
+        {
+            const auto& typeStats = stats[type];
+            if(!typeStats.stages[Stage::Ack].count)
+            {
+                continue;
+            }
+
+            out.print(reinterpret_cast<const __FlashStringHelper*>(typeNames[type]));
+
+            for(uint8_t stage = 0; stage < StageCount; stage++)
+            {
+                const auto& timing = typeStats.stages[stage];
+                if(!timing.count)
+                {
+                    continue;
+                }
+
+                out.print(reinterpret_cast<const __FlashStringHelper*>(stageNames[stage]));
+                out.print(' ');
+                out.print(timing.min);
+                out.print('/');
+                out.print(timing.total / timing.count);
+                out.print('/');
+                out.print(timing.max);
+            }
+
+            out.print(F(" |"));
+            for(uint8_t bucket = 0; bucket < bucketCount; bucket++)
+            {
+                out.print(' ');
+                out.print(typeStats.histogram[bucket]);
+            }
+
+            out.print('\n');
+        }
+    }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+// Generated by scripts/generate_sound_manifest.py from resources/audio, do not edit
+
+#include <stdint.h>
+#include "avr/pgmspace.h"
+
+struct TrackInfo
+{
+    uint8_t track;
+    uint32_t duration;
+};
+
+namespace SoundManifest
+{
+    PROGMEM constexpr TrackInfo tracks[] =
+    {
+        {1, 89232}, // 01_Intro.mp3
+        {6, 87066}, // 06_Reaction_01.mp3
+        {7, 68075}, // 07_Reaction_02.mp3
+        {8, 157074}, // 08_Reaction_03.mp3
+    };
+
+    constexpr uint8_t trackCount = sizeof(tracks) / sizeof(tracks[0]);
+}
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <stdint.h>
+#include <Arduino.h>
 
-#include "SoftwareSerial.h"
-#include "DFRobotDFPlayerMini.h"
+#include "TimerSerial.hpp"
+#include "DFPlayer.hpp"
+#include "SoundLatency.hpp"
+#include "SoundManifest.hpp"
+#include "utils.hpp"
 #include "debug.hpp"
 #include "settings.hpp"
 
@@ -25,19 +29,55 @@ enum class Song : uint8_t
 
 class SoundController
 {
-    SoftwareSerial serial = {3, 4}; // RX, TX
-    DFRobotDFPlayerMini player;
+public:
+    struct Stats
+    {
+        uint8_t maxDepth = 0;
+
+        uint16_t sent = 0;
+        uint16_t completed = 0;
+        uint16_t retries = 0;
+        uint16_t failures = 0;
+        uint16_t coalesced = 0;
+        uint16_t dropped = 0;
+
+        uint16_t minLatency = -1;
+        uint16_t maxLatency = 0;
+        uint32_t totalLatency = 0;
+
+        uint16_t averageLatency() const
+        {
+            return completed ? totalLatency / completed : 0;
+        }
+    };
+
+private:
+    TimerSerial serial;
+    DFPlayer::Parser parser;
+
+    struct Command
+    {
+        DFPlayer::Command code;
+        uint16_t param;
+        uint8_t attempts;
+        uint32_t queuedAt;
+    };
+
+    static constexpr uint8_t queueSize = 6;
+    Command queue[queueSize] = {};
+    uint8_t queueCount = 0;
 
     bool isInit = false;
+    bool awaitingAck = false;
+    uint32_t sentAt = 0;
 
-    uint8_t volume = -1;
-    uint8_t wantVolume;
+    static constexpr uint16_t probeDelay = 300;
+    static constexpr uint16_t ackTimeout = 150;
+    static constexpr uint8_t maxAttempts = 3;
 
-    bool isLoop = false;
-    bool wantLoop = true;
+    uint8_t volume = -1;
 
     Song song = Song::None;
-    Song wantSong = Song::None;
 
     enum class State
     {
@@ -47,114 +87,449 @@ class SoundController
     };
 
     State state = State::Stopped;
-    State wantState = State::Stopped;
 
+    // What the module is actually doing, as confirmed by its acks.
+    // The position is kept locally from the manifest durations, the module is never polled for it.
+    struct Playback
+    {
+        Song song = Song::None;
+        bool playing = false;
+        bool looping = false;
+        uint32_t position = 0;
+        TrackInfo track = {};
+    };
+
+    Playback playback;
+    Song finishedSong = Song::None;
     uint32_t lastUpdate = 0;
-    uint32_t updateDelay = 300;
 
-public:
-    void init()
+    Stats stats;
+    SoundLatency<debug::soundLatency> latency;
+
+    enum class Group : uint8_t
     {
-        serial.begin(9600);
-    }
+        Playback,
+        Volume,
+        Loop,
+        Other
+    };
 
-    void update()
+    static Group groupOf(DFPlayer::Command code)
     {
-        const auto now = millis();
-        if(now - lastUpdate < updateDelay)
+        switch(code)
         {
-            return;
+            case DFPlayer::Command::Play:
+            case DFPlayer::Command::Resume:
+            case DFPlayer::Command::Pause:
+            case DFPlayer::Command::Stop:
+                return Group::Playback;
+            case DFPlayer::Command::Volume:
+                return Group::Volume;
+            case DFPlayer::Command::SingleLoop:
+                return Group::Loop;
+            default:
+                return Group::Other;
         }
+    }
 
-        lastUpdate = now;
+    static bool isToggle(DFPlayer::Command code)
+    {
+        return code == DFPlayer::Command::Pause || code == DFPlayer::Command::Resume;
+    }
+
+    // A pending pause/resume is undone by its opposite, so both can be dropped
+    static bool cancels(DFPlayer::Command queued, DFPlayer::Command code)
+    {
+        return isToggle(queued) && isToggle(code) && queued != code;
+    }
 
-        if(debug::fastPath)
+    static bool supersedes(DFPlayer::Command queued, DFPlayer::Command code)
+    {
+        const auto group = groupOf(code);
+        if(group != groupOf(queued) || group == Group::Other)
         {
-            wantVolume = 5;
+            return false;
         }
-        else
+
+        if(group != Group::Playback)
         {
-            wantVolume = settings.volume; 
+            return true;
         }
 
-        if(!isInit)
+        return isToggle(queued) || code == DFPlayer::Command::Play || code == DFPlayer::Command::Stop;
+    }
+
+    void removeAt(uint8_t index)
+    {
+        for(uint8_t x = index + 1; x < queueCount; x++)
         {
-            isInit = player.begin(serial, false);
-            return;
+            queue[x - 1] = queue[x];
         }
 
-        if(isLoop != wantLoop)
+        queueCount--;
+    }
+
+    void push(DFPlayer::Command code, uint16_t param = 0)
+    {
+        // The head is on the wire while awaiting its ack, it can't be touched anymore.
+        // Superseded entries are all dropped and the new command goes to the tail, so it still
+        // runs after anything that was queued before it.
+        for(uint8_t x = awaitingAck ? 1 : 0; x < queueCount; )
         {
-            isLoop = wantLoop;
-            if(isLoop)
+            const auto queued = queue[x].code;
+            if(cancels(queued, code))
             {
-                player.enableLoop();
+                removeAt(x);
+                stats.coalesced++;
+                return;
             }
-            else
+
+            if(supersedes(queued, code))
             {
-                player.disableLoop();
+                removeAt(x);
+                stats.coalesced++;
+                continue;
             }
 
+            x++;
+        }
+
+        if(queueCount >= queueSize)
+        {
+            stats.dropped++;
             return;
         }
 
-        if(volume != wantVolume)
+        queue[queueCount++] = {code, param, 0, millis()};
+
+        if(queueCount > stats.maxDepth)
         {
-            volume = wantVolume;
-            player.volume(volume); //Set volume value. From 0 to 30
+            stats.maxDepth = queueCount;
+        }
+    }
+
+    void send(DFPlayer::Command code, uint16_t param, bool ack)
+    {
+        uint8_t frame[DFPlayer::FrameSize];
+        DFPlayer::encode(frame, code, param, ack);
+        serial.write(frame, sizeof(frame));
+    }
+
+    void sendHead(uint32_t now)
+    {
+        auto& command = queue[0];
+        command.attempts++;
+
+        send(command.code, command.param, true);
+
+        awaitingAck = true;
+        sentAt = now;
+        stats.sent++;
+
+        latency.onSent(command.code, command.queuedAt);
+    }
+
+    static TrackInfo findTrack(uint8_t number)
+    {
+        for(uint8_t x = 0; x < SoundManifest::trackCount; x++)
+        {
+            const auto track = readPgm(SoundManifest::tracks[x]);
+            if(track.track == number)
+            {
+                return track;
+            }
+        }
+
+        return {number, 0};
+    }
+
+    void onCommandDone(const Command& command)
+    {
+        if(command.code == DFPlayer::Command::Play)
+        {
+            playback.song = static_cast<Song>(command.param);
+            playback.playing = true;
+            playback.position = 0;
+            playback.track = findTrack(command.param);
+        }
+        else if(command.code == DFPlayer::Command::Pause)
+        {
+            playback.playing = false;
+        }
+        else if(command.code == DFPlayer::Command::Resume)
+        {
+            playback.playing = playback.song != Song::None;
+        }
+        else if(command.code == DFPlayer::Command::Stop)
+        {
+            playback.song = Song::None;
+            playback.playing = false;
+            playback.position = 0;
+        }
+        else if(command.code == DFPlayer::Command::SingleLoop)
+        {
+            playback.looping = command.param == 0;
+        }
+    }
 
+    void onTrackEnd()
+    {
+        finishedSong = playback.song;
+
+        // The module repeats the whole file
+        if(playback.looping)
+        {
+            playback.position = 0;
+        }
+        else
+        {
+            playback.playing = false;
+            playback.position = playback.track.duration;
+        }
+    }
+
+    void advancePlayback(uint32_t now)
+    {
+        const auto elapsed = now - lastUpdate;
+        lastUpdate = now;
+
+        if(!playback.playing || !playback.track.duration)
+        {
             return;
         }
 
-        if(wantSong != song)
+        playback.position += elapsed;
+        if(playback.position >= playback.track.duration)
         {
-            song = wantSong;
-            state = State::Playing;
+            onTrackEnd();
+        }
+    }
 
-            player.play(static_cast<uint8_t>(song));
+    void onAck(uint32_t now)
+    {
+        if(!awaitingAck)
+        {
+            return;
+        }
+
+        onCommandDone(queue[0]);
+        latency.onAck(queue[0].code, queue[0].queuedAt, now);
+
+        const uint16_t queueLatency = now - queue[0].queuedAt;
+        stats.completed++;
+        stats.totalLatency += queueLatency;
+        if(queueLatency < stats.minLatency)
+        {
+            stats.minLatency = queueLatency;
+        }
+        if(queueLatency > stats.maxLatency)
+        {
+            stats.maxLatency = queueLatency;
+        }
 
+        awaitingAck = false;
+        removeAt(0);
+    }
+
+    void onFailure()
+    {
+        awaitingAck = false;
+
+        if(queue[0].attempts < maxAttempts)
+        {
+            stats.retries++;
             return;
         }
 
-        if(wantState != state)
+        stats.failures++;
+        removeAt(0);
+    }
+
+    void onReply(const DFPlayer::Frame& frame, uint32_t now)
+    {
+        const auto reply = static_cast<DFPlayer::Reply>(frame.command);
+
+        if(reply == DFPlayer::Reply::Initialized && isInit)
+        {
+            // The module rebooted on its own, everything it knew is gone
+            volume = -1;
+            push(DFPlayer::Command::SingleLoop, 0);
+        }
+
+        isInit = true;
+
+        if(reply == DFPlayer::Reply::Ack)
+        {
+            onAck(now);
+        }
+        else if(reply == DFPlayer::Reply::Error)
+        {
+            if(awaitingAck)
+            {
+                onFailure();
+            }
+        }
+        else if(reply == DFPlayer::Reply::CardFinished)
         {
-            state = wantState;
-            if(state == State::Paused)
+            // Only used to resync, unless our own clock already wrapped around
+            constexpr uint16_t resyncWindow = 1000;
+            if(playback.playing && frame.param == playback.track.track && playback.position > resyncWindow)
             {
-                player.pause();
+                onTrackEnd();
             }
-            else if(state == State::Playing)
+        }
+    }
+
+    void receive(uint32_t now)
+    {
+        while(serial.available())
+        {
+            if(parser.push(serial.read()))
             {
-                player.start();
+                onReply(parser.frame, now);
             }
-            else if(state == State::Stopped)
+        }
+    }
+
+public:
+    void init()
+    {
+        serial.begin();
+        latency.init();
+
+        // Probe right away, the module answers while the displays come up
+        sentAt = millis();
+        send(DFPlayer::Command::QueryStatus, 0, false);
+
+        push(DFPlayer::Command::SingleLoop, 0);
+    }
+
+    bool isReady() const
+    {
+        return isInit;
+    }
+
+    void update()
+    {
+        const auto now = millis();
+
+        advancePlayback(now);
+        receive(now);
+        latency.update(now);
+
+        if(!isInit)
+        {
+            if(now - sentAt >= probeDelay)
             {
-                song = Song::None;
-                player.stop();
+                sentAt = now;
+                send(DFPlayer::Command::QueryStatus, 0, false);
             }
 
             return;
         }
+
+        const uint8_t wantVolume = debug::fastPath ? 5 : settings.volume;
+        if(volume != wantVolume)
+        {
+            volume = wantVolume;
+            push(DFPlayer::Command::Volume, volume); //Set volume value. From 0 to 30
+        }
+
+        if(awaitingAck && now - sentAt >= ackTimeout)
+        {
+            onFailure();
+        }
+
+        if(!awaitingAck && queueCount)
+        {
+            sendHead(now);
+        }
     }
 
-    void play(Song song)
+    void play(Song newSong)
     {
-        wantSong = song;
-        wantState = State::Playing;
+        if(song == newSong && state == State::Playing)
+        {
+            return;
+        }
+
+        song = newSong;
+        state = State::Playing;
+        finishedSong = Song::None;
+        push(DFPlayer::Command::Play, static_cast<uint8_t>(song));
     }
 
     void pause()
     {
-        wantState = State::Paused;
+        if(state != State::Playing)
+        {
+            return;
+        }
+
+        state = State::Paused;
+        push(DFPlayer::Command::Pause);
     }
 
     void resume()
     {
-        wantState = State::Playing;
+        if(state != State::Paused)
+        {
+            return;
+        }
+
+        state = State::Playing;
+        push(DFPlayer::Command::Resume);
     }
 
     void stop()
     {
-        wantState = State::Stopped;
+        if(state == State::Stopped)
+        {
+            return;
+        }
+
+        song = Song::None;
+        state = State::Stopped;
+        push(DFPlayer::Command::Stop);
+    }
+
+    // Milliseconds into the current track, counted locally from the manifest duration
+    uint32_t getPosition() const
+    {
+        return playback.position;
     }
-};
\ No newline at end of file
+
+    bool isPlaying() const
+    {
+        return playback.playing;
+    }
+
+    // Manifest entry of the current track, the duration is 0 for a track missing from the manifest
+    TrackInfo getTrackInfo() const
+    {
+        return playback.track;
+    }
+
+    // The song that reached its end since the last call or the last play(), None otherwise
+    Song takeFinishedSong()
+    {
+        const auto finished = finishedSong;
+        finishedSong = Song::None;
+        return finished;
+    }
+
+    void dumpLatency(Print& out) const
+    {
+        latency.dump(out);
+    }
+
+    uint8_t getQueueDepth() const
+    {
+        return queueCount;
+    }
+
+    const Stats& getStats() const
+    {
+        return stats;
+    }
+};
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include "avr/pgmspace.h"
+
+#include "Storage.hpp"
+#include "Games.hpp"
+#include "utils.hpp"
+
+// Lifetime counters of the box, kept in EEPROM only. Each event updates just the cells it touches.
+namespace Statistics
+{
+    static constexpr uint8_t version = 1;
+
+    static constexpr uint8_t difficultyCount = 3;
+    static constexpr uint8_t reactionBucketCount = 8;
+
+    // Bucket widths in 25ms units, each bucket starts where the previous one ends and the last one is open ended.
+    // Buckets start at 0, 150, 200, 250, 300, 400, 500 and 700ms.
+    static constexpr uint8_t bucketUnit = 25;
+    static constexpr PROGMEM uint8_t reactionBucketWidths[reactionBucketCount - 1] = {6, 2, 2, 2, 4, 4, 8};
+
+    struct Record
+    {
+        uint8_t version;
+        uint16_t plays[GameCount];
+        uint16_t zaps[GameState::maxPlayerCount];
+        uint16_t reactions[difficultyCount][reactionBucketCount];
+        uint16_t votingCount;
+        uint32_t votingTotal;
+    };
+
+    static_assert(Storage::statisticsAddress + sizeof(Record) <= Storage::regionEnd(Storage::statisticsAddress));
+
+    inline Record& stored()
+    {
+        return *reinterpret_cast<Record*>(Storage::statisticsAddress);
+    }
+
+    inline void increment(uint16_t* address)
+    {
+        const uint16_t value = eeprom_read_word(address);
+        if(value != 0xFFFF)
+        {
+            eeprom_update_word(address, value + 1);
+        }
+    }
+
+    inline void add(uint32_t* address, uint32_t amount)
+    {
+        const uint32_t value = eeprom_read_dword(address);
+        const uint32_t sum = value + amount;
+        eeprom_update_dword(address, sum < value ? 0xFFFFFFFF : sum);
+    }
+
+    // Wipes the record when it was never written or was written by an incompatible build
+    inline void init()
+    {
+        auto& record = stored();
+        if(eeprom_read_byte(&record.version) == version)
+        {
+            return;
+        }
+
+        auto address = reinterpret_cast<uint8_t*>(&record);
+        for(uint8_t x = 0; x < sizeof(Record); x++)
+        {
+            eeprom_update_byte(address + x, 0);
+        }
+
+        eeprom_update_byte(&record.version, version);
+    }
+
+    inline uint16_t bucketStart(uint8_t bucket)
+    {
+        uint16_t start = 0;
+        for(uint8_t x = 0; x < bucket; x++)
+        {
+            start += readPgm(reactionBucketWidths[x]) * bucketUnit;
+        }
+
+        return start;
+    }
+
+    inline uint8_t reactionBucket(uint16_t time)
+    {
+        uint16_t end = 0;
+        for(uint8_t x = 0; x < reactionBucketCount - 1; x++)
+        {
+            end += readPgm(reactionBucketWidths[x]) * bucketUnit;
+            if(time < end)
+            {
+                return x;
+            }
+        }
+
+        return reactionBucketCount - 1;
+    }
+
+    // Called once the game reached its end, zaps are counted per handle
+    inline void recordGame(const GameState& state)
+    {
+        auto& record = stored();
+
+        increment(&record.plays[state.gameIndex]);
+
+        for(uint8_t x = 0; x < GameState::maxPlayerCount; x++)
+        {
+            if(state.isPlayerDead(x))
+            {
+                increment(&record.zaps[x]);
+            }
+        }
+    }
+
+    inline void recordReaction(GameState::Difficulty difficulty, uint16_t time)
+    {
+        if(difficulty == GameState::Difficulty::None)
+        {
+            return;
+        }
+
+        increment(&stored().reactions[static_cast<uint8_t>(difficulty)][reactionBucket(time)]);
+    }
+
+    inline void recordVoting(uint32_t duration)
+    {
+        auto& record = stored();
+        increment(&record.votingCount);
+        add(&record.votingTotal, duration);
+    }
+
+    inline uint16_t getPlays(uint8_t game)
+    {
+        return eeprom_read_word(&stored().plays[game]);
+    }
+
+    inline uint16_t getZaps(uint8_t handle)
+    {
+        return eeprom_read_word(&stored().zaps[handle]);
+    }
+
+    inline uint16_t getReactions(uint8_t difficulty, uint8_t bucket)
+    {
+        return eeprom_read_word(&stored().reactions[difficulty][bucket]);
+    }
+
+    inline uint32_t getAverageVoting()
+    {
+        const auto count = eeprom_read_word(&stored().votingCount);
+        return count ? eeprom_read_dword(&stored().votingTotal) / count : 0;
+    }
+
+    // Start of the bucket holding the median reaction, -1 without any reaction recorded
+    inline int16_t getMedianReaction(uint8_t difficulty)
+    {
+        uint32_t total = 0;
+        for(uint8_t x = 0; x < reactionBucketCount; x++)
+        {
+            total += getReactions(difficulty, x);
+        }
+
+        if(total == 0)
+        {
+            return -1;
+        }
+
+        uint32_t seen = 0;
+        for(uint8_t x = 0; x < reactionBucketCount; x++)
+        {
+            seen += getReactions(difficulty, x);
+            if(seen * 2 >= total)
+            {
+                return bucketStart(x);
+            }
+        }
+
+        return bucketStart(reactionBucketCount - 1);
+    }
+
+    inline void dump(Print& out)
+    {
+        out.println(F("stats"));
+
+        for(uint8_t x = 0; x < GameCount; x++)
+        {
+            out.print(F("plays "));
+            out.print(x);
+            out.print(' ');
+            out.println(getPlays(x));
+        }
+
+        for(uint8_t x = 0; x < GameState::maxPlayerCount; x++)
+        {
+            out.print(F("zaps "));
+            out.print(x);
+            out.print(' ');
+            out.println(getZaps(x));
+        }
+
+        for(uint8_t x = 0; x < difficultyCount; x++)
+        {
+            out.print(F("reactions "));
+            out.print(x);
+            for(uint8_t y = 0; y < reactionBucketCount; y++)
+            {
+                out.print(' ');
+                out.print(bucketStart(y));
+                out.print(':');
+                out.print(getReactions(x, y));
+            }
+            out.println();
+        }
+
+        out.print(F("voting "));
+        out.print(eeprom_read_word(&stored().votingCount));
+        out.print(' ');
+        out.println(getAverageVoting());
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+namespace Storage
+{
+    // EEPROM layout, regions are fixed so a firmware update keeps what was stored
+    static constexpr uint16_t settingsAddress = 0;
+    static constexpr uint8_t settingsSlots = 16;
+
+    static constexpr uint16_t statisticsAddress = 128;
+
+    static constexpr uint16_t tuningAddress = 256;
+
+    // Session recordings take the rest, see Replay.hpp
+    static constexpr uint16_t replayAddress = 384;
+    static constexpr uint16_t replaySize = E2END + 1 - replayAddress;
+
+    static_assert(settingsAddress < statisticsAddress && statisticsAddress < tuningAddress && tuningAddress < replayAddress && replayAddress <= E2END);
+
+    // Where the next region starts, what is stored at address must end before it
+    constexpr uint16_t regionEnd(uint16_t address)
+    {
+        return address < statisticsAddress ? statisticsAddress
+            : address < tuningAddress ? tuningAddress
+            : address < replayAddress ? replayAddress
+            : E2END + 1;
+    }
+
+    // Keeps the latest copy of T in a ring of slots, each write goes to the next slot so the
+    // wear is spread. Records are [version][sequence][T][crc], an erased or torn slot fails the crc
+    // and the newest valid sequence wins.
+    template<typename T, uint16_t Address, uint8_t SlotCount, uint8_t Version>
+    class RecordRing
+    {
+        static_assert(Version != 0xFF, "0xFF is what erased EEPROM reads as");
+
+        static constexpr uint8_t recordSize = sizeof(T) + 3;
+        static_assert(Address + recordSize * SlotCount <= regionEnd(Address));
+
+        uint8_t slot = SlotCount - 1;
+        uint8_t sequence = 0;
+        T saved{};
+
+        static uint8_t* slotAddress(uint8_t index)
+        {
+            return reinterpret_cast<uint8_t*>(Address + recordSize * index);
+        }
+
+        static uint8_t crc(uint8_t sequence, const T& value)
+        {
+            uint8_t crc = _crc8_ccitt_update(0, Version);
+            crc = _crc8_ccitt_update(crc, sequence);
+
+            const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+            for(uint8_t x = 0; x < sizeof(T); x++)
+            {
+                crc = _crc8_ccitt_update(crc, bytes[x]);
+            }
+
+            return crc;
+        }
+
+    public:
+        // Returns false and leaves value untouched when no valid record exists
+        bool load(T& value)
+        {
+            bool found = false;
+
+            for(uint8_t x = 0; x < SlotCount; x++)
+            {
+                uint8_t record[recordSize];
+                eeprom_read_block(record, slotAddress(x), recordSize);
+
+                if(record[0] != Version)
+                {
+                    continue;
+                }
+
+                T candidate;
+                memcpy(&candidate, record + 2, sizeof(T));
+                if(record[recordSize - 1] != crc(record[1], candidate))
+                {
+                    continue;
+                }
+
+                // Sequences wrap, they are only ever compared within the span of the ring
+                const int8_t age = record[1] - sequence;
+                if(!found || age > 0)
+                {
+                    found = true;
+                    slot = x;
+                    sequence = record[1];
+                    saved = candidate;
+                }
+            }
+
+            if(found)
+            {
+                value = saved;
+            }
+
+            return found;
+        }
+
+        // Returns false if nothing changed since the last save
+        bool save(const T& value)
+        {
+            if(memcmp(&value, &saved, sizeof(T)) == 0)
+            {
+                return false;
+            }
+
+            slot = (slot + 1) % SlotCount;
+            sequence++;
+            saved = value;
+
+            uint8_t record[recordSize];
+            record[0] = Version;
+            record[1] = sequence;
+            memcpy(record + 2, &value, sizeof(T));
+            record[recordSize - 1] = crc(sequence, value);
+
+            eeprom_update_block(record, slotAddress(slot), recordSize);
+
+            return true;
+        }
+    };
+}
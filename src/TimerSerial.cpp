@@ -0,0 +1,200 @@
+#include "TimerSerial.hpp"
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+namespace
+{
+    // Timer2 runs free at F_CPU / 32, both compare units are moved forward one bit at a time
+    constexpr uint8_t bitTicks = F_CPU / 32 / TimerSerial::Baud;
+    static_assert(bitTicks + bitTicks / 2 < 256, "Start bit to first sample must fit in Timer2");
+
+    constexpr uint8_t rxMask = _BV(TimerSerial::RxPin);
+    constexpr uint8_t txMask = _BV(TimerSerial::TxPin);
+
+    constexpr uint8_t bufferSize = 32;
+    constexpr uint8_t bufferMask = bufferSize - 1;
+    static_assert((bufferSize & bufferMask) == 0);
+
+    volatile uint8_t txBuffer[bufferSize];
+    volatile uint8_t txHead = 0;
+    volatile uint8_t txTail = 0;
+    volatile bool txActive = false;
+    uint8_t txShift = 0;
+    uint8_t txBit = 0;
+
+    volatile uint8_t rxBuffer[bufferSize];
+    volatile uint8_t rxHead = 0;
+    volatile uint8_t rxTail = 0;
+    volatile bool rxActive = false;
+    uint8_t rxShift = 0;
+    uint8_t rxBit = 0;
+
+    void armStartBit()
+    {
+        EIFR = _BV(INTF1);
+        EIMSK |= _BV(INT1);
+    }
+}
+
+void TimerSerial::begin()
+{
+    PORTD |= txMask;
+    DDRD |= txMask;
+
+    DDRD &= ~rxMask;
+    PORTD |= rxMask;
+
+    TCCR2A = 0;
+    TCCR2B = _BV(CS21) | _BV(CS20);
+    TIMSK2 = 0;
+
+    // Falling edge on INT1 is the start bit
+    EICRA = (EICRA & ~(_BV(ISC10) | _BV(ISC11))) | _BV(ISC11);
+    armStartBit();
+}
+
+bool TimerSerial::write(const uint8_t* data, uint8_t count)
+{
+    const uint8_t used = (txHead - txTail) & bufferMask;
+    if(count > bufferMask - used)
+    {
+        return false;
+    }
+
+    for(uint8_t x = 0; x < count; x++)
+    {
+        txBuffer[txHead] = data[x];
+        txHead = (txHead + 1) & bufferMask;
+    }
+
+    const uint8_t sreg = SREG;
+    cli();
+    if(!txActive)
+    {
+        txActive = true;
+        txBit = 10;
+        OCR2A = TCNT2 + 2;
+        TIFR2 = _BV(OCF2A);
+        TIMSK2 |= _BV(OCIE2A);
+    }
+    SREG = sreg;
+
+    return true;
+}
+
+uint8_t TimerSerial::available()
+{
+    return (rxHead - rxTail) & bufferMask;
+}
+
+uint8_t TimerSerial::read()
+{
+    if(rxHead == rxTail)
+    {
+        return 0;
+    }
+
+    const uint8_t byte = rxBuffer[rxTail];
+    rxTail = (rxTail + 1) & bufferMask;
+    return byte;
+}
+
+bool TimerSerial::isIdle()
+{
+    return !txActive && !rxActive;
+}
+
+bool TimerSerial::isSending()
+{
+    return txActive;
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+    if(txBit == 10)
+    {
+        // Previous stop bit is complete, start the next byte or go quiet
+        if(txHead == txTail)
+        {
+            TIMSK2 &= ~_BV(OCIE2A);
+            txActive = false;
+            return;
+        }
+
+        txShift = txBuffer[txTail];
+        txTail = (txTail + 1) & bufferMask;
+        txBit = 0;
+    }
+
+    if(txBit == 0)
+    {
+        PORTD &= ~txMask;
+    }
+    else if(txBit <= 8)
+    {
+        if(txShift & 1)
+        {
+            PORTD |= txMask;
+        }
+        else
+        {
+            PORTD &= ~txMask;
+        }
+        txShift >>= 1;
+    }
+    else
+    {
+        PORTD |= txMask;
+    }
+
+    txBit++;
+    OCR2A += bitTicks;
+}
+
+ISR(INT1_vect)
+{
+    EIMSK &= ~_BV(INT1);
+
+    rxActive = true;
+    rxBit = 0;
+    rxShift = 0;
+
+    // First sample lands in the middle of data bit 0
+    OCR2B = TCNT2 + bitTicks + bitTicks / 2;
+    TIFR2 = _BV(OCF2B);
+    TIMSK2 |= _BV(OCIE2B);
+}
+
+ISR(TIMER2_COMPB_vect)
+{
+    const bool high = PIND & rxMask;
+
+    if(rxBit < 8)
+    {
+        rxShift >>= 1;
+        if(high)
+        {
+            rxShift |= 0x80;
+        }
+
+        rxBit++;
+        OCR2B += bitTicks;
+        return;
+    }
+
+    // Stop bit, a low line here is a framing error and the byte is discarded
+    if(high)
+    {
+        const uint8_t next = (rxHead + 1) & bufferMask;
+        if(next != rxTail)
+        {
+            rxBuffer[rxHead] = rxShift;
+            rxHead = next;
+        }
+    }
+
+    TIMSK2 &= ~_BV(OCIE2B);
+    rxActive = false;
+    armStartBit();
+}
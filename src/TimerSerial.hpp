@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+// Interrupt driven 9600 baud UART for the sound module, D3 (RX) / D4 (TX).
+// Bits are clocked by Timer2 compare interrupts and the start bit is caught on INT1,
+// so nothing ever spins with interrupts disabled while a byte is on the wire.
+class TimerSerial
+{
+public:
+    static constexpr uint8_t RxPin = 3;
+    static constexpr uint8_t TxPin = 4;
+
+    static constexpr uint32_t Baud = 9600;
+
+    static void begin();
+
+    // Queues the bytes for transmission, returns false (sending nothing) if they don't fit
+    static bool write(const uint8_t* data, uint8_t count);
+
+    static uint8_t available();
+    static uint8_t read();
+
+    // True when no byte is being shifted in or out
+    static bool isIdle();
+
+    static bool isSending();
+};
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <stdint.h>
+#include "avr/pgmspace.h"
+
+#include "FixedPoint.hpp"
+
+// Angles, sine, cosine, atan2 and square roots for Fixed, from small PROGMEM tables built at compile time.
+// Angles are binary: a full turn is 65536 so they wrap around for free, 0 points along +x and a
+// quarter turn along +y. Every table has its end point so linear interpolation never reads past it.
+namespace Trig
+{
+    using Angle = uint16_t;
+
+    constexpr Angle quarterTurn = 0x4000;
+    constexpr Angle halfTurn = 0x8000;
+
+    constexpr Angle fromDegrees(int16_t angle)
+    {
+        return static_cast<int32_t>(angle) * 0x10000 / 360;
+    }
+
+    // Nearest saves a multiply, Linear is within one unit of the table values
+    enum class Interpolation : uint8_t
+    {
+        Nearest,
+        Linear
+    };
+
+    // Sine and cosine, exact at 1
+    using Unit = Fixed<2, 14>;
+
+    namespace Generate
+    {
+        constexpr double pi = 3.14159265358979323846;
+
+        constexpr double sqrt(double x)
+        {
+            double root = x > 1 ? x : 1;
+            for(uint8_t step = 0; step < 40; step++)
+            {
+                root = (root + x / root) / 2;
+            }
+            return root;
+        }
+
+        // Taylor series, good enough over a quarter turn
+        constexpr double sin(double x)
+        {
+            double term = x;
+            double sum = x;
+            for(uint8_t n = 1; n < 12; n++)
+            {
+                term *= -x * x / ((2 * n) * (2 * n + 1));
+                sum += term;
+            }
+            return sum;
+        }
+
+        // Halved once so the series converges quickly up to 1
+        constexpr double atan(double x)
+        {
+            const double half = x / (1 + sqrt(1 + x * x));
+
+            double term = half;
+            double sum = half;
+            for(uint8_t n = 1; n < 30; n++)
+            {
+                term *= -half * half;
+                sum += term / (2 * n + 1);
+            }
+            return 2 * sum;
+        }
+
+        constexpr uint16_t toTable(double x)
+        {
+            return x >= 0xFFFF ? 0xFFFF : static_cast<uint16_t>(x + 0.5);
+        }
+    }
+
+    // Steps + 1 increasing values sampled at positions in 1/256 of a step
+    template<uint8_t Steps>
+    struct Table
+    {
+        uint16_t values[Steps + 1];
+
+        constexpr Table(uint16_t (*generate)(uint8_t)) : values{}
+        {
+            for(uint16_t x = 0; x <= Steps; x++)
+            {
+                values[x] = generate(x);
+            }
+        }
+
+        uint16_t operator[](uint8_t index) const
+        {
+            return pgm_read_word(&values[index]);
+        }
+
+        template<Interpolation Mode>
+        uint16_t sample(uint16_t position) const
+        {
+            const uint8_t index = position >> 8;
+            const uint8_t fraction = position;
+
+            if constexpr(Mode == Interpolation::Nearest)
+            {
+                return (*this)[index + (fraction >> 7)];
+            }
+            else
+            {
+                const uint16_t low = (*this)[index];
+                if(fraction == 0)
+                {
+                    return low;
+                }
+
+                const uint16_t high = (*this)[index + 1];
+                return low + (FixedMath::multiply(static_cast<uint16_t>(high - low), static_cast<uint16_t>(fraction)) >> 8);
+            }
+        }
+    };
+
+    // A quarter turn of sine in Unit
+    PROGMEM constexpr Table<64> sineTable{[](uint8_t x)
+    {
+        return Generate::toTable(Generate::sin(x * Generate::pi / 2 / 64) * (1 << 14));
+    }};
+
+    // atan of 0 to 1, up to an eighth of a turn
+    PROGMEM constexpr Table<64> atanTable{[](uint8_t x)
+    {
+        return Generate::toTable(Generate::atan(x / 64.0) / (2 * Generate::pi) * 0x10000);
+    }};
+
+    // Square roots of 0x4000 to 0x10000 in 1/256
+    PROGMEM constexpr Table<48> sqrtTable{[](uint8_t x)
+    {
+        return Generate::toTable(Generate::sqrt(0x4000 + x * 0x400) * 256);
+    }};
+
+    template<Interpolation Mode = Interpolation::Linear>
+    Unit sin(Angle angle)
+    {
+        const uint8_t quadrant = angle >> 14;
+
+        uint16_t position = angle & (quarterTurn - 1);
+        if(quadrant & 1)
+        {
+            position = quarterTurn - position;
+        }
+
+        const int16_t value = sineTable.sample<Mode>(position);
+        return Unit::fromRaw(quadrant & 2 ? -value : value);
+    }
+
+    template<Interpolation Mode = Interpolation::Linear>
+    Unit cos(Angle angle)
+    {
+        return sin<Mode>(angle + quarterTurn);
+    }
+
+    // Angle of the vector (x, y), 0 for the null vector
+    template<Interpolation Mode = Interpolation::Linear>
+    Angle atan2(int32_t y, int32_t x)
+    {
+        uint32_t absX = x < 0 ? -static_cast<uint32_t>(x) : x;
+        uint32_t absY = y < 0 ? -static_cast<uint32_t>(y) : y;
+
+        while((absX | absY) > 0xFFFF)
+        {
+            absX >>= 1;
+            absY >>= 1;
+        }
+
+        const bool steep = absY > absX;
+        const uint16_t high = steep ? absY : absX;
+        const uint16_t low = steep ? absX : absY;
+
+        if(high == 0)
+        {
+            return 0;
+        }
+
+        Angle angle = atanTable.sample<Mode>((static_cast<uint32_t>(low) << 14) / high);
+
+        if(steep)
+        {
+            angle = quarterTurn - angle;
+        }
+
+        if(x < 0)
+        {
+            angle = halfTurn - angle;
+        }
+
+        if(y < 0)
+        {
+            angle = -angle;
+        }
+
+        return angle;
+    }
+
+    template<Interpolation Mode = Interpolation::Linear, uint8_t IntBits, uint8_t FracBits, bool Signed>
+    Angle atan2(Fixed<IntBits, FracBits, Signed> y, Fixed<IntBits, FracBits, Signed> x)
+    {
+        return atan2<Mode>(static_cast<int32_t>(y.getRaw()), static_cast<int32_t>(x.getRaw()));
+    }
+
+    // Rounded to the nearest. The table only gets within 1% (Nearest) or 0.1% (Linear), one Newton
+    // step and a check of the squares settle the last bits.
+    template<Interpolation Mode = Interpolation::Linear>
+    uint16_t sqrt(uint32_t value)
+    {
+        if(value == 0)
+        {
+            return 0;
+        }
+
+        // value = mantissa * 4^shift with the mantissa in [0x4000, 0x10000)
+        uint32_t mantissa = value;
+        int8_t shift = 0;
+        while(mantissa >= 0x10000)
+        {
+            mantissa >>= 2;
+            shift++;
+        }
+        while(mantissa < 0x4000)
+        {
+            mantissa <<= 2;
+            shift--;
+        }
+
+        const uint32_t estimate = sqrtTable.sample<Mode>((mantissa - 0x4000) >> 2);
+        const uint8_t down = 8 - shift;
+
+        uint32_t root = down ? (estimate + (1 << (down - 1))) >> down : estimate;
+        root = (root + value / root) / 2;
+        if(root > 0xFFFF)
+        {
+            root = 0xFFFF;
+        }
+
+        // root is the nearest when root² - root < value <= root² + root
+        uint16_t nearest = root;
+        while(nearest < 0xFFFF && FixedMath::multiply(nearest, nearest) + nearest < value)
+        {
+            nearest++;
+        }
+        while(FixedMath::multiply(nearest, nearest) - nearest >= value)
+        {
+            nearest--;
+        }
+
+        return nearest;
+    }
+
+    template<Interpolation Mode = Interpolation::Linear, uint8_t IntBits, uint8_t FracBits, bool Signed>
+    Fixed<IntBits, FracBits, Signed> sqrt(Fixed<IntBits, FracBits, Signed> value)
+    {
+        static_assert(IntBits + FracBits <= 16);
+
+        if(value.getRaw() <= 0)
+        {
+            return {};
+        }
+
+        return Fixed<IntBits, FracBits, Signed>::fromRaw(sqrt<Mode>(static_cast<uint32_t>(value.getRaw()) << FracBits));
+    }
+
+    // Length of the vector (x, y), saturated
+    template<Interpolation Mode = Interpolation::Linear, uint8_t IntBits, uint8_t FracBits>
+    Fixed<IntBits, FracBits> length(Fixed<IntBits, FracBits> x, Fixed<IntBits, FracBits> y)
+    {
+        static_assert(IntBits + FracBits == 16);
+
+        const uint32_t squares = static_cast<uint32_t>(FixedMath::multiply(x.getRaw(), x.getRaw())) + static_cast<uint32_t>(FixedMath::multiply(y.getRaw(), y.getRaw()));
+        return Fixed<IntBits, FracBits>::fromRaw(Fixed<IntBits, FracBits>::saturate(sqrt<Mode>(squares)));
+    }
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <stdint.h>
+#include <avr/eeprom.h>
+#include "avr/pgmspace.h"
+
+#include "str.hpp"
+#include "utils.hpp"
+#include "Storage.hpp"
+#include "settings.hpp"
+
+enum class TuningId : uint8_t
+{
+    PongBallSpeed,
+    PongPaddleSpeed,
+    PongPaddleMaxLength,
+    PongPaddleMinLength,
+
+    ReactionGracePeriod,
+    ReactionMinDuration,
+    ReactionMaxDuration,
+    ReactionEasyMinDuration,
+    ReactionEasyMaxDuration,
+    ReactionWindow,
+    ReactionChangeMinWait,
+    ReactionChangeMaxWait,
+
+    VotingDuration,
+
+    TitleDuration,
+    CountdownStep,
+    ZapsDuration,
+    ResultsDuration,
+    ScoresDuration,
+
+    Count
+};
+
+constexpr uint8_t TuningCount = static_cast<uint8_t>(TuningId::Count);
+
+// A gameplay constant, edited like a setting but never held in RAM:
+// reads come from the EEPROM override when there is one, from the default in flash otherwise.
+struct TuningDefinition : SettingDefinition
+{
+    enum class Unit : uint8_t
+    {
+        None,
+        Deciseconds,
+        Seconds
+    };
+
+    int16_t defaultValue;
+    Unit unit;
+};
+
+#define TUNING_ENTRY(name, defaultValue, min, max, increment, unit) {{name, SettingDefinition::Type::Number, {nullptr, min, max, increment}}, defaultValue, TuningDefinition::Unit::unit}
+
+PROGMEM constexpr TuningDefinition tuningDefinitions[] =
+{
+    TUNING_ENTRY("Pong ball speed"_PSTR, 6, 1, 100, 1, None),
+    TUNING_ENTRY("Pong paddle speed"_PSTR, 10, 1, 64, 1, None),
+    TUNING_ENTRY("Pong paddle max"_PSTR, 20, 8, 40, 2, None),
+    TUNING_ENTRY("Pong paddle min"_PSTR, 8, 2, 20, 1, None),
+
+    TUNING_ENTRY("React grace"_PSTR, 30, 0, 100, 5, Deciseconds),
+    TUNING_ENTRY("React min time"_PSTR, 20, 1, 120, 5, Seconds),
+    TUNING_ENTRY("React max time"_PSTR, 120, 5, 300, 10, Seconds),
+    TUNING_ENTRY("React easy min"_PSTR, 5, 1, 60, 1, Seconds),
+    TUNING_ENTRY("React easy max"_PSTR, 40, 5, 120, 5, Seconds),
+    TUNING_ENTRY("React window"_PSTR, 20, 5, 100, 5, Deciseconds),
+    TUNING_ENTRY("React change min"_PSTR, 30, 5, 100, 5, Deciseconds),
+    TUNING_ENTRY("React change max"_PSTR, 80, 10, 200, 10, Deciseconds),
+
+    TUNING_ENTRY("Vote time"_PSTR, 30, 5, 99, 5, Seconds),
+
+    TUNING_ENTRY("Title time"_PSTR, 20, 5, 100, 5, Deciseconds),
+    TUNING_ENTRY("Countdown step"_PSTR, 10, 3, 20, 1, Deciseconds),
+    TUNING_ENTRY("Zaps time"_PSTR, 10, 5, 50, 5, Deciseconds),
+    TUNING_ENTRY("Results time"_PSTR, 40, 10, 200, 10, Deciseconds),
+    TUNING_ENTRY("Scores time"_PSTR, 100, 20, 300, 10, Deciseconds),
+};
+
+#undef TUNING_ENTRY
+
+static_assert(sizeof(tuningDefinitions) / sizeof(tuningDefinitions[0]) == TuningCount);
+
+namespace Tuning
+{
+    static constexpr uint8_t version = 1;
+
+    struct Overrides
+    {
+        uint8_t version;
+        uint32_t mask;
+        int16_t values[TuningCount];
+    };
+
+    static_assert(TuningCount <= 32);
+    static_assert(Storage::tuningAddress + sizeof(Overrides) <= Storage::regionEnd(Storage::tuningAddress));
+
+    inline Overrides& stored()
+    {
+        return *reinterpret_cast<Overrides*>(Storage::tuningAddress);
+    }
+
+    inline void reset()
+    {
+        eeprom_update_dword(&stored().mask, 0);
+    }
+
+    inline void init()
+    {
+        if(eeprom_read_byte(&stored().version) != version)
+        {
+            reset();
+            eeprom_update_byte(&stored().version, version);
+        }
+    }
+
+    inline const TuningDefinition& definition(TuningId id)
+    {
+        return tuningDefinitions[static_cast<uint8_t>(id)];
+    }
+
+    inline bool isOverridden(TuningId id)
+    {
+        return eeprom_read_dword(&stored().mask) & (1UL << static_cast<uint8_t>(id));
+    }
+
+    // The value as edited, in the unit of its definition
+    inline int16_t getRaw(TuningId id)
+    {
+        const auto& tuning = definition(id);
+        if(!isOverridden(id))
+        {
+            return readPgm(tuning.defaultValue);
+        }
+
+        const int16_t value = eeprom_read_word(reinterpret_cast<uint16_t*>(&stored().values[static_cast<uint8_t>(id)]));
+
+        const auto min = readPgm(tuning.number.min);
+        const auto max = readPgm(tuning.number.max);
+        return value < min ? min : value > max ? max : value;
+    }
+
+    inline uint16_t getUnitScale(TuningDefinition::Unit unit)
+    {
+        switch(unit)
+        {
+            case TuningDefinition::Unit::Deciseconds:
+                return 100;
+            case TuningDefinition::Unit::Seconds:
+                return 1000;
+            default:
+                return 1;
+        }
+    }
+
+    // Durations come out in milliseconds
+    inline int32_t get(TuningId id)
+    {
+        return static_cast<int32_t>(getRaw(id)) * getUnitScale(readPgm(definition(id).unit));
+    }
+
+    inline void set(TuningId id, int16_t value)
+    {
+        const auto index = static_cast<uint8_t>(id);
+        auto& overrides = stored();
+
+        eeprom_update_word(reinterpret_cast<uint16_t*>(&overrides.values[index]), value);
+
+        auto mask = eeprom_read_dword(&overrides.mask);
+        if(value == readPgm(definition(id).defaultValue))
+        {
+            mask &= ~(1UL << index);
+        }
+        else
+        {
+            mask |= 1UL << index;
+        }
+        eeprom_update_dword(&overrides.mask, mask);
+    }
+}
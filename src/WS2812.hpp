@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "avr/pgmspace.h"
+
+#ifndef __AVR__
+#include "Host.hpp"
+#endif
+
+static_assert(F_CPU == 16000000UL, "WS2812 bit timings are counted for 16 MHz");
+
+struct Rgb
+{
+    uint8_t r{};
+    uint8_t g{};
+    uint8_t b{};
+
+    constexpr Rgb() = default;
+
+    constexpr Rgb(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b)
+    {
+    }
+
+    // 0xRRGGBB
+    constexpr Rgb(uint32_t code) : r(code >> 16), g(code >> 8), b(code)
+    {
+    }
+
+    constexpr bool operator==(const Rgb& other) const
+    {
+        return r == other.r && g == other.g && b == other.b;
+    }
+
+    constexpr bool operator!=(const Rgb& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+namespace WS2812
+{
+    // Brightness and per channel correction folded into a single lookup, built at compile time
+    template<uint8_t Scale>
+    struct ScaleTable
+    {
+        uint8_t values[256];
+
+        constexpr ScaleTable() : values{}
+        {
+            for(uint16_t x = 0; x < 256; x++)
+            {
+                values[x] = (x * (Scale + 1)) >> 8;
+            }
+        }
+
+        uint8_t operator[](uint8_t value) const
+        {
+            return pgm_read_byte(&values[value]);
+        }
+    };
+
+    template<uint8_t Scale>
+    PROGMEM constexpr ScaleTable<Scale> scaleTable{};
+
+    constexpr uint8_t channelScale(uint8_t brightness, uint8_t correction)
+    {
+        return (static_cast<uint16_t>(brightness) * (correction + 1)) >> 8;
+    }
+
+    // One byte MSB first, 20 cycles (1.25us) per bit: 0 is high for 6 cycles, 1 for 13.
+    // hi/lo are the whole port value with the data bit set/cleared, interrupts must be off.
+    inline void sendByte(uint8_t byte, uint8_t hi, uint8_t lo)
+    {
+#ifdef __AVR__
+        uint8_t count;
+
+        asm volatile(
+            "ldi  %[count], 8     \n\t"
+            "1:                   \n\t"
+            "out  %[port], %[hi]  \n\t"
+            "nop                  \n\t"
+            "nop                  \n\t"
+            "nop                  \n\t"
+            "nop                  \n\t"
+            "sbrs %[byte], 7      \n\t"
+            "out  %[port], %[lo]  \n\t"
+            "lsl  %[byte]         \n\t"
+            "nop                  \n\t"
+            "nop                  \n\t"
+            "nop                  \n\t"
+            "nop                  \n\t"
+            "nop                  \n\t"
+            "out  %[port], %[lo]  \n\t"
+            "nop                  \n\t"
+            "nop                  \n\t"
+            "nop                  \n\t"
+            "dec  %[count]        \n\t"
+            "brne 1b              \n\t"
+            : [count] "=&d" (count), [byte] "+r" (byte)
+            : [port] "I" (_SFR_IO_ADDR(PORTD)), [hi] "r" (hi), [lo] "r" (lo)
+        );
+#else
+        Host::Leds::write(byte);
+#endif
+    }
+
+    // GRB pixels on a PORTD pin. Interrupts are only masked while a single pixel (30us)
+    // is shifted out, the low gap in between stays well under the 50us latch time.
+    template<uint8_t Bit, uint8_t Brightness, Rgb Correction = Rgb{255, 255, 255}>
+    struct Strip
+    {
+        static constexpr uint8_t mask = 1 << Bit;
+
+        static constexpr auto& red = scaleTable<channelScale(Brightness, Correction.r)>;
+        static constexpr auto& green = scaleTable<channelScale(Brightness, Correction.g)>;
+        static constexpr auto& blue = scaleTable<channelScale(Brightness, Correction.b)>;
+
+        static void init()
+        {
+            PORTD &= ~mask;
+            DDRD |= mask;
+        }
+
+        static void show(const Rgb* pixels, uint8_t count)
+        {
+            for(uint8_t x = 0; x < count; x++)
+            {
+                const auto& pixel = pixels[x];
+                const uint8_t g = green[pixel.g];
+                const uint8_t r = red[pixel.r];
+                const uint8_t b = blue[pixel.b];
+
+                const uint8_t sreg = SREG;
+                cli();
+
+                // Read the port with interrupts off so ISRs driving other PORTD pins aren't undone
+                const uint8_t lo = PORTD & ~mask;
+                const uint8_t hi = lo | mask;
+
+                sendByte(g, hi, lo);
+                sendByte(r, hi, lo);
+                sendByte(b, hi, lo);
+
+                SREG = sreg;
+            }
+        }
+    };
+}
@@ -1,6 +1,48 @@
 #pragma once
 
+#include <stdint.h>
+
+// The profiler owns the Timer1 overflow vector, so it is switched from the build flags (see [env:profile])
+#ifndef PROFILER
+#define PROFILER 0
+#endif
+
+// Session recording in EEPROM, 1 records and 2 plays the recording back (see Replay.hpp and [env:record])
+#ifndef REPLAY
+#define REPLAY 0
+#endif
+
+// The DFPlayer BUSY output (low while playing) is wired to A0, see SoundLatency.hpp
+#ifndef SOUND_BUSY_PIN
+#define SOUND_BUSY_PIN 0
+#endif
+
 namespace debug
 {
     constexpr bool fastPath = false;
-}
\ No newline at end of file
+
+    // Dumps SoundController latencies over the debug serial port
+    constexpr bool soundLatency = false;
+
+    // Adds the audible stage to the sound latencies, needs the BUSY wire
+    constexpr bool soundBusyPin = SOUND_BUSY_PIN;
+
+    // Dumps the persistent statistics over the debug serial port at boot and when they are shown
+    constexpr bool statistics = false;
+
+    // Cycles per subsystem and per frame, see Profiler.hpp
+    constexpr bool profiler = PROFILER;
+
+    // Paints the stack at boot and reports the static RAM per module and the least free stack seen
+    constexpr bool memory = false;
+
+    // Time from reset to the first pixel, the join screen and the sound module, see BootProfiler.hpp
+    constexpr bool boot = false;
+
+    // ReplayMode: Off, Record or Play
+    constexpr uint8_t replay = REPLAY;
+
+    constexpr bool serial = soundLatency || statistics || profiler || memory || boot;
+    constexpr uint32_t serialBaud = 115200;
+    constexpr uint16_t reportDelay = 10000;
+}
@@ -9,6 +9,9 @@
 #include "Display.hpp"
 #include "LedController.hpp"
 #include "Sounds.hpp"
+#include "Tuning.hpp"
+#include "Random.hpp"
+#include "Trig.hpp"
 
 namespace Pong
 {
@@ -19,6 +22,18 @@ namespace Pong
 
     constexpr uint8_t ballSize = 2;
 
+    // Hits on the paddle ends turn the ball by up to edgeDeflection, a moving paddle adds spin.
+    // The result stays within maxBounce of straight back so the ball never runs along the paddle.
+    constexpr Trig::Angle edgeDeflection = Trig::fromDegrees(30);
+    constexpr Trig::Angle spin = Trig::fromDegrees(8);
+    constexpr Trig::Angle maxBounce = Trig::fromDegrees(60);
+
+    // Away from the wall of each player: left, right, top, bottom
+    constexpr Trig::Angle paddleNormals[] = {0, Trig::halfTurn, Trig::quarterTurn, 3 * Trig::quarterTurn};
+
+    // Hard rounds bring in another ball every so many bounces, up to maxBalls
+    constexpr uint8_t bouncesPerBall = 6;
+
     constexpr uint32_t demoDuration = 17000;
     constexpr uint32_t demoGameDuration = 7000;
 
@@ -39,12 +54,12 @@ namespace Pong
         }
     }
 
-    void drawBall(GameState& state, Display& display, bool set)
+    void drawBall(GameState& state, const Ball& ball, bool set)
     {
         auto& data = state.data.pong;
 
-        const auto displayBallX = data.ballX.getInteger();
-        const auto displayBallY = data.ballY.getInteger();
+        const auto displayBallX = ball.x.getInteger();
+        const auto displayBallY = ball.y.getInteger();
         
         for(uint8_t x = 0; x < ballSize; x++)
         {
@@ -55,7 +70,7 @@ namespace Pong
         }
     }
 
-    void drawPaddles(GameState& state, Display& display, bool set)
+    void drawPaddles(GameState& state, bool set)
     {
         auto& data = state.data.pong;
 
@@ -85,71 +100,275 @@ namespace Pong
         }
     }
 
-    void moveBall(GameState& state)
+    // Columns and pages of the field buffer that changed, empty until something is added
+    struct Area
     {
-        auto& data = state.data.pong;
+        uint8_t left = 0xFF;
+        uint8_t right = 0;
+        uint8_t top = 0xFF;
+        uint8_t bottom = 0;
 
-        const auto ballPaddleoverlap = [&](FixedPoint ballPosition, FixedPoint paddlePosition)
+        bool isEmpty() const
         {
-            return ballPosition + ballSize > paddlePosition && ballPosition < paddlePosition + data.paddleLength;
-        };
+            return left > right;
+        }
 
-        const auto deltaX = data.ballVelX * state.deltaTime;
-        const auto deltaY = data.ballVelY * state.deltaTime;
+        void add(uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+        {
+            left = x < left ? x : left;
+            right = x + width - 1 > right ? x + width - 1 : right;
+            top = y / 8 < top ? y / 8 : top;
+            bottom = (y + height - 1) / 8 > bottom ? (y + height - 1) / 8 : bottom;
+        }
 
-        if(data.ballX + deltaX >= fieldWidth - ballSize)
+        void add(const Area& other)
         {
-            state.onPlayerDie(1);
+            if(!other.isEmpty())
+            {
+                add(other.left, other.top * 8, other.right - other.left + 1, (other.bottom - other.top + 1) * 8);
+            }
         }
-        else if(data.ballX + deltaX >= fieldWidth - ballSize - data.paddleOffset && ballPaddleoverlap(data.ballY, data.paddlePositions[1]))
+
+        bool operator==(const Area& other) const = default;
+    };
+
+    Area ballArea(const Ball& ball)
+    {
+        Area area;
+        area.add(ball.x.getInteger(), ball.y.getInteger(), ballSize, ballSize);
+        return area;
+    }
+
+    Area paddleArea(GameState& state, uint8_t player)
+    {
+        auto& data = state.data.pong;
+
+        const auto position = data.paddlePositions[player].getInteger();
+
+        Area area;
+        if(player == 0)
         {
-            data.ballVelX = -data.ballVelX;
-            data.ballX.setFraction(0);
-            data.ballVelY += (data.paddleDirections & (1 << 1)) ? data.paddleBoost : -data.paddleBoost;
-            data.bounceCount++;
+            area.add(data.paddleOffset, position, 1, data.paddleLength);
         }
-        else if(deltaX < 0 && (1 - deltaX) >= data.ballX)
+        else if(player == 1)
         {
-            state.onPlayerDie(0);
+            area.add(fieldWidth - data.paddleOffset - 1, position, 1, data.paddleLength);
         }
-        else if(deltaX < 0 && (1 - deltaX) + data.paddleOffset >= data.ballX &&  ballPaddleoverlap(data.ballY, data.paddlePositions[0]))
+        else if(player == 2)
         {
-            data.ballVelX = -data.ballVelX;
-            data.ballX.setFraction(0);
-            data.ballVelY += (data.paddleDirections & (1 << 0)) ? data.paddleBoost : -data.paddleBoost;
-            data.bounceCount++;
+            area.add(position, data.paddleOffset, data.paddleLength, 1);
         }
         else
         {
-            data.ballX += deltaX;
+            area.add(position, fieldHeight - data.paddleOffset - 1, data.paddleLength, 1);
+        }
+        return area;
+    }
+
+    void setBallDirection(GameState& state, Ball& ball, Trig::Angle angle)
+    {
+        auto& data = state.data.pong;
+
+        ball.velX = data.ballSpeed * Q4_12::rounded(Trig::cos(angle));
+        ball.velY = data.ballSpeed * Q4_12::rounded(Trig::sin(angle));
+    }
+
+    // Mirrors the ball off the paddle of player, then turns it by where it hit and how the paddle moves
+    void bounce(GameState& state, Ball& ball, uint8_t player)
+    {
+        auto& data = state.data.pong;
+
+        const bool vertical = player <= 1;
+        const auto normal = paddleNormals[player];
+
+        const auto incoming = Trig::atan2(ball.velY, ball.velX);
+        const Trig::Angle mirrored = vertical ? Trig::halfTurn - incoming : -incoming;
+
+        // -1 to 1 from the middle of the paddle to its ends
+        const auto along = vertical ? ball.y : ball.x;
+        const auto reach = FixedPoint((data.paddleLength + ballSize) / 2);
+        auto offset = (along + ballSize / 2 - data.paddlePositions[player] - data.paddleLength / 2) / reach;
+        if(offset > 1)
+        {
+            offset = 1;
+        }
+        else if(offset < -1)
+        {
+            offset = -1;
         }
 
-        if(data.ballY + deltaY >= fieldWidth - ballSize)
+        int16_t turn = static_cast<int32_t>(offset.getRaw()) * edgeDeflection >> 8;
+        turn += (data.paddleDirections & (1 << player)) ? spin : -spin;
+
+        // Positive turns go towards +y on the left, +x at the bottom
+        if(player == 1 || player == 2)
         {
-            state.onPlayerDie(3);
+            turn = -turn;
         }
-        else if(data.ballY + deltaY >= fieldWidth - ballSize - data.paddleOffset && ballPaddleoverlap(data.ballX, data.paddlePositions[3]))
+
+        int16_t relative = static_cast<int16_t>(mirrored - normal) + turn;
+        if(relative > static_cast<int16_t>(maxBounce))
         {
-            data.ballVelY = -data.ballVelY;
-            data.ballY.setFraction(0);
-            data.ballVelX += (data.paddleDirections & (1 << 2)) ? data.paddleBoost : -data.paddleBoost;
-            data.bounceCount++;
+            relative = maxBounce;
         }
-        else if(deltaY < 0 && (1 - deltaY) >= data.ballY)
+        else if(relative < -static_cast<int16_t>(maxBounce))
         {
-            state.onPlayerDie(2);
+            relative = -maxBounce;
         }
-        else if(deltaY < 0 && (1 - deltaY) + data.paddleOffset >= data.ballY &&  ballPaddleoverlap(data.ballX, data.paddlePositions[2]))
+
+        setBallDirection(state, ball, normal + relative);
+        data.bounceCount++;
+    }
+
+    struct Hit
+    {
+        static constexpr uint8_t none = 0xFF;
+
+        // Fraction of the step
+        FixedPoint time = 1;
+        uint8_t player = none;
+        bool paddle = false;
+    };
+
+    // What the ball meets first along one axis during the step: the paddle of the player on that side when it
+    // is in the way at that time, or else the wall behind it. Kept in hit when it comes sooner.
+    void checkAxis(GameState& state, Hit& hit, FixedPoint position, FixedPoint delta, FixedPoint along, FixedPoint alongDelta, uint8_t nearPlayer)
+    {
+        if(delta == 0)
         {
-            data.ballVelY = -data.ballVelY;
-            data.ballY.setFraction(0);
-            data.ballVelX += (data.paddleDirections & (1 << 2)) ? data.paddleBoost : -data.paddleBoost;
-            data.bounceCount++;
+            return;
         }
-        else
+
+        auto& data = state.data.pong;
+
+        const bool far = delta > 0;
+        const uint8_t player = nearPlayer + far;
+
+        // Top left corner of the ball when it touches them
+        const FixedPoint paddlePlane = far ? fieldWidth - data.paddleOffset - 1 - ballSize : data.paddleOffset + 1;
+        const FixedPoint wallPlane = far ? fieldWidth - 1 - ballSize : 1;
+
+        const auto target = position + delta;
+
+        const auto reaches = [&](FixedPoint plane)
+        {
+            return far ? target >= plane : target <= plane;
+        };
+
+        const auto timeTo = [&](FixedPoint plane)
+        {
+            const auto time = (plane - position) / delta;
+            return time < 0 ? FixedPoint() : time;
+        };
+
+        // A ball already past the paddle only has the wall left
+        const bool beforePaddle = far ? position <= paddlePlane : position >= paddlePlane;
+        if(beforePaddle && reaches(paddlePlane))
+        {
+            const auto time = timeTo(paddlePlane);
+            const auto alongThen = along + alongDelta * time;
+            const auto paddle = data.paddlePositions[player];
+
+            if(alongThen + ballSize > paddle && alongThen < paddle + data.paddleLength)
+            {
+                if(time < hit.time)
+                {
+                    hit = {time, player, true};
+                }
+                return;
+            }
+        }
+
+        if(reaches(wallPlane))
+        {
+            const auto time = timeTo(wallPlane);
+            if(time < hit.time)
+            {
+                hit = {time, player, false};
+            }
+        }
+    }
+
+    // Swept against the paddles and walls, so a fast ball can't go through a paddle and the wall it reaches
+    // first is the one that counts. A bounce spends the rest of the step in the new direction.
+    void moveBall(GameState& state, Ball& ball)
+    {
+        constexpr uint8_t maxBounces = 4;
+
+        FixedPoint remaining = 1;
+        for(uint8_t x = 0; x < maxBounces; x++)
+        {
+            const auto deltaX = FixedPoint::rounded(ball.velX * Q4_12(GameState::tickTime)) * remaining;
+            const auto deltaY = FixedPoint::rounded(ball.velY * Q4_12(GameState::tickTime)) * remaining;
+
+            Hit hit;
+            checkAxis(state, hit, ball.x, deltaX, ball.y, deltaY, 0);
+            checkAxis(state, hit, ball.y, deltaY, ball.x, deltaX, 2);
+
+            if(hit.player == Hit::none)
+            {
+                ball.x += deltaX;
+                ball.y += deltaY;
+                return;
+            }
+
+            ball.x += deltaX * hit.time;
+            ball.y += deltaY * hit.time;
+
+            if(hit.paddle)
+            {
+                bounce(state, ball, hit.player);
+            }
+            else if(state.isPlayerAlive(hit.player))
+            {
+                state.onPlayerDie(hit.player);
+                return;
+            }
+            else if(hit.player <= 1)
+            {
+                // Nobody to lose behind that wall, it sends the ball straight back
+                ball.velX = -ball.velX;
+            }
+            else
+            {
+                ball.velY = -ball.velY;
+            }
+
+            remaining -= remaining * hit.time;
+        }
+    }
+
+    // The ball coming closest to the wall of player, or the first one when none is heading there
+    const Ball& trackedBall(GameState& state, uint8_t player)
+    {
+        auto& data = state.data.pong;
+
+        const bool vertical = player <= 1;
+        const bool far = player & 1;
+
+        const Ball* tracked = &data.balls[0];
+        FixedPoint closest = fieldWidth;
+
+        for(uint8_t x = 0; x < data.ballCount; x++)
         {
-            data.ballY += deltaY;
+            const auto& ball = data.balls[x];
+            const auto position = vertical ? ball.x : ball.y;
+            const auto velocity = vertical ? ball.velX : ball.velY;
+
+            if(far ? velocity <= 0 : velocity >= 0)
+            {
+                continue;
+            }
+
+            const auto distance = far ? fieldWidth - position : position;
+            if(distance < closest)
+            {
+                closest = distance;
+                tracked = &ball;
+            }
         }
+
+        return *tracked;
     }
 
     void movePaddles(GameState& state)
@@ -164,13 +383,14 @@ namespace Pong
 
             if(!state.isPlayerAlive(x) || state.phase == GameState::Phase::Demo)
             {
-                const auto ballCenter = (x <= 1 ? data.ballY : data.ballX) + ballSize / 2;
+                const auto& ball = trackedBall(state, x);
+                const auto ballCenter = (x <= 1 ? ball.y : ball.x) + ballSize / 2;
                 position = ballCenter - data.paddleLength / 2;
             }
             else
             {
                 const auto speed = data.paddleSpeed;
-                position += (direction ? speed : -speed) * state.deltaTime;
+                position += (direction ? speed : -speed) * GameState::tickTime;
             }
 
             if(position < 1)
@@ -215,45 +435,42 @@ namespace Pong
         }
     }
 
+    // From the middle, diagonal towards any of the corners, never straight at a player
+    Trig::Angle launchBall(GameState& state, Ball& ball)
+    {
+        ball.x = fieldWidth / 2;
+        ball.y = fieldHeight / 2;
+
+        const Trig::Angle angle = Trig::fromDegrees(25) + Random::below16(Trig::fromDegrees(40)) + Random::below(4) * Trig::quarterTurn;
+        setBallDirection(state, ball, angle);
+        return angle;
+    }
+
     void init(GameState& state)
     {
         auto& data = state.data.pong;
 
-        data.ballX = fieldWidth / 2;
-        data.ballY = fieldWidth / 2;
+        data.ballStartSpeed = Tuning::get(TuningId::PongBallSpeed);
+        data.paddleSpeed = FixedPoint::fromRaw(Tuning::get(TuningId::PongPaddleSpeed));
+        data.paddleMaxLength = Tuning::get(TuningId::PongPaddleMaxLength);
+        data.paddleMinLength = Tuning::get(TuningId::PongPaddleMinLength);
+        data.paddleLength = data.paddleMaxLength;
 
         const auto startSpeed = state.phase == GameState::Phase::Demo ? data.ballStartSpeed * 3 : data.ballStartSpeed;
 
-        const auto ballVelX = startSpeed / 3;
-        const auto ballVelY = startSpeed - ballVelX;
-
-        data.ballVelX = FixedPoint(0, ballVelX);
-        data.ballVelY = FixedPoint(0, ballVelY);
-
-        if(random(0, 2))
-        {
-            data.ballVelX = -data.ballVelX;
-        }
-
-        if(random(0, 2))
-        {
-            data.ballVelY = -data.ballVelY;
-        }
+        // The tuning speed used to be split 1:2 over the axes, 3/4 of it is the same length
+        data.ballSpeed = Q4_12(FixedPoint::fromRaw(startSpeed)) * Q4_12::fromFloat(0.75f);
 
-        if(random(0, 2))
-        {
-            const auto temp = data.ballVelY;
-            data.ballVelY = data.ballVelX;
-            data.ballVelX = temp;
-        }
+        data.ballCount = 1;
+        auto& ball = data.balls[0];
+        const auto angle = launchBall(state, ball);
 
         if(state.phase != GameState::Phase::Demo)
         {
-            for(uint8_t x = 0; x < 8; x++)
-            {
-                data.ballX = data.ballX - data.ballVelX * FixedPoint(100);
-                data.ballY = data.ballY - data.ballVelY * FixedPoint(100);
-            }
+            // Starts a bit back along its path, by distance so a fast ball doesn't start outside the field
+            constexpr int8_t rewind = 14;
+            ball.x -= FixedPoint::rounded(Trig::cos(angle)) * rewind;
+            ball.y -= FixedPoint::rounded(Trig::sin(angle)) * rewind;
         }
 
         data.paddleDirections = 0;
@@ -319,91 +536,163 @@ namespace Pong
         display.printP(instruction);
     }
 
-    void update(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    void startRound(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        state.data.pong = {};
+        init(state);
+    }
+
+    void showInstructions(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        drawInstructions(state, display);
+    }
+
+    void skipResults(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        soundController.stop();
+        state.advance();
+    }
+
+    void updateField(GameState& state, Display& display, Input& input)
     {
         auto& data = state.data.pong;
 
-        if(state.phase != state.lastPhase)
+        display.selectPlayers(state.playerPresence);
+
+        // Where everything was, everything is erased before moving so overlapping balls come back whole
+        Area areas[maxBalls + GameState::maxPlayerCount];
+        for(uint8_t x = 0; x < data.ballCount; x++)
         {
-            if(state.phase == GameState::Phase::Demo || state.phase == GameState::Phase::Running)
-            {
-                data = {};
-                init(state);
-                return;
-            }
-            else if(state.phase == GameState::Phase::Instructions)
+            areas[x] = ballArea(data.balls[x]);
+            drawBall(state, data.balls[x], false);
+        }
+        for(uint8_t x = 0; x < GameState::maxPlayerCount; x++)
+        {
+            areas[maxBalls + x] = paddleArea(state, x);
+        }
+        drawPaddles(state, false);
+
+
+        if(data.bounceCount / 3 <= data.paddleMaxLength - data.paddleMinLength)
+        {
+            data.paddleLength = data.paddleMaxLength - data.bounceCount / 3;
+        }
+
+        controlPaddles(state, input);
+
+        // One physics step per tick, bounces happen at the same place whatever the frame time
+        for(uint8_t x = 0; x < state.ticks; x++)
+        {
+            for(uint8_t y = 0; y < data.ballCount; y++)
             {
-                drawInstructions(state, display);
-                return;
+                moveBall(state, data.balls[y]);
             }
-            else if(state.phase == GameState::Phase::GameResults)
+            movePaddles(state);
+
+            if(state.phase == GameState::Phase::Running && state.playerPresence != state.playerAlive)
             {
-                soundController.stop();
-                state.advance();
-            }
-            else if(state.phase == GameState::Phase::Scores)
-            {                
+                break;
             }
         }
 
-        if(state.phase != GameState::Phase::Running && state.phase != GameState::Phase::Demo)
+        if(state.phase == GameState::Phase::Running && state.difficulty == GameState::Difficulty::Hard &&
+            data.ballCount < maxBalls && data.bounceCount >= data.ballCount * bouncesPerBall)
         {
-            return;
+            launchBall(state, data.balls[data.ballCount++]);
         }
 
-        if(state.phase == GameState::Phase::Running && state.playerPresence != state.playerAlive)
+        for(uint8_t x = 0; x < data.ballCount; x++)
         {
-            state.advance();
-            return;
+            drawBall(state, data.balls[x], true);
         }
+        drawPaddles(state, true);
 
-        display.selectPlayers(state.playerPresence);
+        if(data.fullDraw || state.redraw)
+        {
+            data.fullDraw = false;
+            state.redraw = false;
 
-        if(state.phase == GameState::Phase::Demo)
+            drawField(state);
+            display.draw(data.buffer, fieldX, fieldY);
+            return;
+        }
+
+        // Only the pages each ball and paddle touched, so more balls don't mean a lot more bytes
+        for(uint8_t x = 0; x < maxBalls + GameState::maxPlayerCount; x++)
         {
-            if(state.playCount[state.gameIndex] > 1)
+            Area area;
+            if(x < maxBalls)
             {
-                soundController.play(Song::Pong);
-                state.advance();
-                return;
+                if(x < data.ballCount)
+                {
+                    area = ballArea(data.balls[x]);
+                }
             }
-
-            if(state.phaseDuration >= demoDuration)
+            else
             {
-                state.advance();
-                return;
+                area = paddleArea(state, x - maxBalls);
             }
 
-            if(state.phaseDuration >= demoGameDuration)
+            if(area == areas[x])
             {
-                if(state.phaseDuration - state.deltaTime < demoGameDuration)
-                {
-                    soundController.play(Song::Pong);
-                    drawDemo(state, display);
-                }
-                
-                return;
+                continue;
             }
+
+            area.add(areas[x]);
+            display.drawArea(data.buffer, fieldX, fieldY, area.left, area.top, area.right - area.left + 1, area.bottom - area.top + 1);
         }
+    }
 
-        drawField(state);
+    void playDemo(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        auto& co = state.script;
+        CO_BEGIN(co, state.deltaTime);
 
-        drawBall(state, display, false);
-        drawPaddles(state, display, false);
-        
-        if(data.bounceCount / 3 <= data.paddleMaxLength - data.paddleMinLength)
+        if(state.playCount[state.gameIndex] > 1)
         {
-            data.paddleLength = data.paddleMaxLength - data.bounceCount / 3;
+            soundController.play(Song::Pong);
+            state.advance();
+            return;
         }
 
-        controlPaddles(state, input);
+        while(state.phaseDuration < demoGameDuration)
+        {
+            updateField(state, display, input);
+            CO_YIELD(co);
+        }
+
+        display.selectPlayers(state.playerPresence);
+        soundController.play(Song::Pong);
+        drawDemo(state, display);
+        CO_DELAY(co, demoDuration - demoGameDuration);
 
-        moveBall(state);
-        movePaddles(state);
+        state.advance();
 
-        drawBall(state, display, true);
-        drawPaddles(state, display, true);
-        
-        display.draw(data.buffer, fieldX, fieldY);
+        CO_END(co);
+    }
+
+    void updateRunning(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        if(state.playerPresence != state.playerAlive)
+        {
+            state.advance();
+            return;
+        }
+
+        updateField(state, display, input);
     }
+
+    PROGMEM const PhaseHandlers phases[GamePhaseCount] =
+    {
+        {},
+        {},
+        {.onEnter=startRound, .onUpdate=playDemo},
+        {.onEnter=showInstructions},
+        {},
+        {.onEnter=startRound, .onUpdate=updateRunning},
+        {},
+        {.onEnter=skipResults},
+        {},
+        {},
+    };
 }
\ No newline at end of file
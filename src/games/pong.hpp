@@ -12,15 +12,28 @@ struct GameState;
 
 namespace Pong
 {
+    static constexpr uint8_t maxBalls = 3;
+
+    struct Ball
+    {
+        FixedPoint x = 64 / 2;
+        FixedPoint y = 64 / 2;
+
+        // Pixels per ms, finer than positions so the bounce angles hold
+        Q4_12 velX = {};
+        Q4_12 velY = {};
+    };
+
     struct Data
     {
-        FixedPoint ballX = 64 / 2;
-        FixedPoint ballY = 64 / 2;
+        uint8_t ballStartSpeed = 6;
 
-        uint8_t ballStartSpeed = 6; 
+        // Every ball goes as fast, bounces only turn them
+        Q4_12 ballSpeed = {};
 
-        FixedPoint ballVelX = FixedPoint(0, 5);
-        FixedPoint ballVelY = FixedPoint(0, 5);
+        // The first ballCount are in play, Hard rounds bring in the others as they go
+        Ball balls[maxBalls];
+        uint8_t ballCount = 1;
 
         int8_t paddleMaxLength = 20;
         int8_t paddleMinLength = 8;
@@ -28,20 +41,22 @@ namespace Pong
 
         int8_t paddleOffset = 3;
         FixedPoint paddleSpeed = FixedPoint(0, 10);
-        FixedPoint paddleBoost = FixedPoint(0, 2);
         int8_t paddleDirections = {};
         FixedPoint paddlePositions[4] = {};
 
         uint8_t bounceCount = 0;
 
+        // The whole field goes out at the start and after the screens were cleared, then only what moved
+        bool fullDraw = true;
+
         DisplayBuffer<64, 64> buffer;
     };
 
-    void update(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& SoundController);
+    extern const PhaseHandlers phases[GamePhaseCount];
 
     constexpr GameDefinition definition
     {
         "Pong"_PSTR,
-        update
+        phases
     };
 }
@@ -9,6 +9,9 @@
 #include "Display.hpp"
 #include "LedController.hpp"
 #include "Sounds.hpp"
+#include "Statistics.hpp"
+#include "Tuning.hpp"
+#include "Random.hpp"
 #include "debug.hpp"
 
 namespace Reaction
@@ -25,7 +28,7 @@ namespace Reaction
             }
             else
             {
-                targetCount = random(0, lenght);
+                targetCount = Random::below(lenght);
                 if(targetCount >= condition.number)
                 {
                     targetCount++;
@@ -36,22 +39,22 @@ namespace Reaction
         {
             if(correct)
             {
-                targetCount = random(0, condition.number);
+                targetCount = Random::below(condition.number);
             }
             else
             {
-                targetCount = random(condition.number, lenght + 1);
+                targetCount = Random::range(condition.number, lenght + 1);
             }
         }
         else if(condition.comparaison == NumberCondition::Comparaison::AtLeast)
         {
             if(correct)
             {
-                targetCount = random(condition.number, lenght + 1);
+                targetCount = Random::range(condition.number, lenght + 1);
             }
             else
             {
-                targetCount = random(0, condition.number);
+                targetCount = Random::below(condition.number);
             }
         }
 
@@ -71,7 +74,7 @@ namespace Reaction
 
         for(uint8_t fillerIndex = 0; fillerIndex < fillers.size - 1 && used < data.size; fillerIndex++)
         {
-            const uint8_t count = random(0, data.size - used);
+            const uint8_t count = Random::below(data.size - used);
             for(uint8_t x = 0; x < count && used < data.size; x++)
             {
                 data.data[used++] = fillers.data[fillerIndex];
@@ -120,11 +123,11 @@ namespace Reaction
                 fillers[used++] = x;
             }
         }
-        shuffle(fillers, sizeof(fillers));
+        Random::shuffle(fillers, sizeof(fillers));
 
         fillFromCondition({data, element.shapeCount}, static_cast<uint8_t>(element.targetShape), {fillers, sizeof(fillers)}, element.condition, correct);
 
-        shuffle(data, element.shapeCount);
+        Random::shuffle(data, element.shapeCount);
 
         const auto width = 24;
         const auto spacing = (Display::Width - element.shapeCount * width) / (element.shapeCount + 1);
@@ -154,11 +157,11 @@ namespace Reaction
                 fillers[used++] = x;
             }
         }
-        shuffle(fillers, sizeof(fillers));
+        Random::shuffle(fillers, sizeof(fillers));
 
         fillFromCondition({data, ledCount}, static_cast<uint8_t>(element.targetColor), {fillers, colorCount - 1}, element.condition, correct);
 
-        shuffle(data, ledCount);
+        Random::shuffle(data, ledCount);
 
         static constexpr PROGMEM uint32_t colors[] =
         {
@@ -193,7 +196,7 @@ namespace Reaction
 
         auto& timing = data.timings[type];
         timing.lastChange = state.phaseDuration;
-        timing.nextChange = timing.lastChange + random(timing.minWait, timing.maxWait); 
+        timing.nextChange = timing.lastChange + Random::range32(timing.minWait, timing.maxWait); 
 
         if(type == ElementType::Shapes)
         {
@@ -312,16 +315,24 @@ namespace Reaction
             data.minDuration = 2000;
             data.maxDuration = 5000;
         }
+        else if(state.difficulty == GameState::Difficulty::Easy)
+        {
+            data.minDuration = Tuning::get(TuningId::ReactionEasyMinDuration);
+            data.maxDuration = Tuning::get(TuningId::ReactionEasyMaxDuration);
+        }
         else
         {
-            if(state.difficulty == GameState::Difficulty::Easy)
-            {
-                data.minDuration = static_cast<uint32_t>(1000) * 5;
-                data.maxDuration = static_cast<uint32_t>(1000) * 40;
-            }
+            data.minDuration = Tuning::get(TuningId::ReactionMinDuration);
+            data.maxDuration = Tuning::get(TuningId::ReactionMaxDuration);
         }
 
-        data.duration = random(data.minDuration, data.maxDuration);
+        data.gracePeriod = Tuning::get(TuningId::ReactionGracePeriod);
+        data.timeToReactAfterFirst = Tuning::get(TuningId::ReactionWindow);
+
+        const uint32_t changeMinWait = Tuning::get(TuningId::ReactionChangeMinWait);
+        const uint32_t changeMaxWait = Tuning::get(TuningId::ReactionChangeMaxWait);
+
+        data.duration = Random::range32(data.minDuration, data.maxDuration);
 
         if(state.difficulty == GameState::Difficulty::Easy)
         {
@@ -346,8 +357,8 @@ namespace Reaction
 
             data.timings[ElementType::Sound] =
             {
-                3000, //min
-                8000, //max
+                changeMinWait, //min
+                changeMaxWait, //max
 
                 0,0
             };
@@ -356,26 +367,26 @@ namespace Reaction
         data.elementsActive |= (1 << ElementType::Leds);
         if(data.elementsActive & (1 << ElementType::Leds))
         {
-            data.ledsElement.targetColor = static_cast<LedsElement::Colors>(random(0, LedsElement::Colors::Count));
+            data.ledsElement.targetColor = static_cast<LedsElement::Colors>(Random::below(LedsElement::Colors::Count));
 
-            data.ledsElement.condition.comparaison = static_cast<NumberCondition::Comparaison>(random(0, NumberCondition::Comparaison::Count));
+            data.ledsElement.condition.comparaison = static_cast<NumberCondition::Comparaison>(Random::below(NumberCondition::Comparaison::Count));
             if(data.ledsElement.condition.comparaison == NumberCondition::Comparaison::Equal)
             {
-                data.ledsElement.condition.number = random(0, 10);
+                data.ledsElement.condition.number = Random::below(10);
             }
             else if(data.ledsElement.condition.comparaison == NumberCondition::Comparaison::AtLeast)
             {
-                data.ledsElement.condition.number = random(3, 10);
+                data.ledsElement.condition.number = Random::range(3, 10);
             }
             else if(data.ledsElement.condition.comparaison == NumberCondition::Comparaison::Less)
             {
-                data.ledsElement.condition.number = random(3, 9);
+                data.ledsElement.condition.number = Random::range(3, 9);
             }
 
             data.timings[ElementType::Leds] =
             {
-                3000, //min
-                8000, //max
+                changeMinWait, //min
+                changeMaxWait, //max
 
                 0,0
             };
@@ -385,26 +396,26 @@ namespace Reaction
         if(data.elementsActive & (1 << ElementType::Shapes))
         {
             data.shapeElement.shapeCount = data.shapeElement.maxShapeCount;
-            data.shapeElement.targetShape = static_cast<ShapesElement::Shape>(random(0, ShapesElement::Shape::Count));
+            data.shapeElement.targetShape = static_cast<ShapesElement::Shape>(Random::below(ShapesElement::Shape::Count));
 
-            data.shapeElement.condition.comparaison = static_cast<NumberCondition::Comparaison>(random(0, NumberCondition::Comparaison::Count));
+            data.shapeElement.condition.comparaison = static_cast<NumberCondition::Comparaison>(Random::below(NumberCondition::Comparaison::Count));
             if(data.shapeElement.condition.comparaison == NumberCondition::Comparaison::Equal)
             {
-                data.shapeElement.condition.number = random(0, 5);
+                data.shapeElement.condition.number = Random::below(5);
             }
             else if(data.shapeElement.condition.comparaison == NumberCondition::Comparaison::AtLeast)
             {
-                data.shapeElement.condition.number = random(2, 5);
+                data.shapeElement.condition.number = Random::range(2, 5);
             }
             else if(data.shapeElement.condition.comparaison == NumberCondition::Comparaison::Less)
             {
-                data.shapeElement.condition.number = random(2, 5);
+                data.shapeElement.condition.number = Random::range(2, 5);
             }
 
             data.timings[ElementType::Shapes] =
             {
-                3000, //min
-                8000, //max
+                changeMinWait, //min
+                changeMaxWait, //max
 
                 0,0
             };
@@ -622,6 +633,19 @@ namespace Reaction
         }
     }
 
+    void recordStatistics(GameState& state)
+    {
+        auto& data = state.data.reaction;
+
+        for(int8_t x = 0; x < GameState::maxPlayerCount; x++)
+        {
+            if(state.isPlayerPresent(x) && data.playerReactionTimestamp[x])
+            {
+                Statistics::recordReaction(state.difficulty, data.playerReactionTimestamp[x] - data.firstCorrectTime);
+            }
+        }
+    }
+
     void showResults(GameState& state, Display& display)
     {
         auto& data = state.data.reaction;
@@ -688,60 +712,63 @@ namespace Reaction
         }
     }
 
-    void update(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    void startGame(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
     {
-        auto& data = state.data.reaction;
+        state.data.reaction = {};
+        initDifficulty(state);
+    }
 
-        if(state.phase != state.lastPhase)
-        {
-            if(state.phase == GameState::Phase::Init)
-            {
-                data = {};
-                initDifficulty(state);
-            }
-            else if(state.phase == GameState::Phase::Demo)
-            {
-                state.advance();
-                return;
-            }
-            else if(state.phase == GameState::Phase::Instructions)
-            {
-                soundController.play(Song::Reaction_Intro);
-                drawInstructions(state, display);
-                return;
-            }
-            else if(state.phase == GameState::Phase::Countdown)
-            {
-                const Song song = static_cast<Song>(random(static_cast<uint8_t>(Song::Reaction_Start), static_cast<uint8_t>(Song::Reaction_End) + 1));
-                soundController.play(song);
-            }
-            else if(state.phase == GameState::Phase::Running)
-            {
-                initElements(state, display, input, ledController, soundController);
-                drawConditions(state, display);
-            }
-            else if(state.phase == GameState::Phase::GameResults)
-            {
-                showResults(state, display);
-            }
-        }
+    void skipDemo(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        state.advance();
+    }
 
-        if(state.phase == GameState::Phase::GameResults)
-        {
-            if (state.phaseDuration > 4000)
-            {
-                state.advance();
-            }            
-        }
+    void showInstructions(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        soundController.play(Song::Reaction_Intro);
+        drawInstructions(state, display);
+    }
 
-        if(state.phase != GameState::Phase::Running)
-        {
-            return;
-        }
+    void playStartSong(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        const Song song = static_cast<Song>(Random::range(static_cast<uint8_t>(Song::Reaction_Start), static_cast<uint8_t>(Song::Reaction_End) + 1));
+        soundController.play(song);
+    }
+
+    void startRound(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        initElements(state, display, input, ledController, soundController);
+        drawConditions(state, display);
+    }
+
+    void playResults(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        auto& co = state.script;
+        CO_BEGIN(co, state.deltaTime);
+
+        recordStatistics(state);
+        showResults(state, display);
+        CO_DELAY(co, Tuning::get(TuningId::ResultsDuration));
+
+        state.advance();
+
+        CO_END(co);
+    }
+
+    void updateRound(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        auto& data = state.data.reaction;
 
         updateTiming(state, display, input, ledController, soundController);
         updatePlayerInputs(state, display, input);
 
+        // The next track when one ends, rather than looping the same one all game long
+        const auto finished = soundController.takeFinishedSong();
+        if(finished >= Song::Reaction_Start && finished <= Song::Reaction_End)
+        {
+            soundController.play(finished == Song::Reaction_End ? Song::Reaction_Start : static_cast<Song>(static_cast<uint8_t>(finished) + 1));
+        }
+
         if(data.firstCorrectTime == 0 && data.elementsActive == data.elementsCorrect)
         {
             data.firstCorrectTime = state.phaseDuration;
@@ -769,4 +796,18 @@ namespace Reaction
             display.print_UL(data.duration);
         }
     }
-}
\ No newline at end of file
+
+    PROGMEM const PhaseHandlers phases[GamePhaseCount] =
+    {
+        {.onEnter=startGame},
+        {},
+        {.onEnter=skipDemo},
+        {.onEnter=showInstructions},
+        {.onEnter=playStartSong},
+        {.onEnter=startRound, .onUpdate=updateRound},
+        {},
+        {.onUpdate=playResults},
+        {},
+        {},
+    };
+}
@@ -124,11 +124,11 @@ namespace Reaction
         bool firstTrigger = true;
     };
 
-    void update(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& SoundController);
+    extern const PhaseHandlers phases[GamePhaseCount];
 
     constexpr GameDefinition definition
     {
         "Reaction"_PSTR,
-        update
+        phases
     };
 }
@@ -9,6 +9,9 @@
 #include "Display.hpp"
 #include "LedController.hpp"
 #include "Sounds.hpp"
+#include "Statistics.hpp"
+#include "Tuning.hpp"
+#include "Random.hpp"
 #include "debug.hpp"
 
 namespace Voting
@@ -48,6 +51,7 @@ namespace Voting
     {
         auto& data = state.data.voting;
         data = {};
+        data.votingDuration = Tuning::get(TuningId::VotingDuration) / 1000;
 
         for(int8_t x = 0; x < state.maxPlayerCount; x++)
         {
@@ -56,12 +60,7 @@ namespace Voting
                continue;
             }
             
-            auto& vote = data.playerVotes[x];
-            do
-            {
-                vote = random(state.maxPlayerCount);
-            }
-            while(!state.isPlayerAlive(vote));
+            data.playerVotes[x] = Random::member(state.playerPresence & state.playerAlive);
         }
     }
 
@@ -201,65 +200,59 @@ namespace Voting
         }
     }
 
-    void update(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    void startGame(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
     {
-        auto& data = state.data.voting;
+        init(state, display);
+    }
+
+    void skipDemo(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        state.advance();
+    }
+
+    void showInstructions(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        soundController.play(Song::Voting);
+        drawInstructions(state, display);
+    }
 
-        if(state.phase != state.lastPhase)
+    void startVote(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        for(int8_t x = 0; x < state.maxPlayerCount; x++)
         {
-            if(state.phase == GameState::Phase::Demo)
-            {
-                state.advance();
-                return;
-            }
-            else if(state.phase == GameState::Phase::Init)
-            {
-                init(state, display);
-            }
-            else if(state.phase == GameState::Phase::Instructions)
+            if(!state.isPlayerAlive(x))
             {
-                soundController.play(Song::Voting);
-                drawInstructions(state, display);
-                return;
+                continue;
             }
-            else if(state.phase == GameState::Phase::Running)
-            {
-                for(int8_t x = 0; x < state.maxPlayerCount; x++)
-                {
-                    if(!state.isPlayerAlive(x))
-                    {
-                        continue;
-                    }
 
-                    drawDirection(state, display, x);
-                }
+            drawDirection(state, display, x);
+        }
 
-                display.selectPlayers(state.playerAlive);
+        display.selectPlayers(state.playerAlive);
 
-                display.startDraw(0, Display::Height - Font::charHeight * 3, Display::Width, Font::charHeight * 2);
-                display.printP("Press to select next  player"_PSTR);
+        display.startDraw(0, Display::Height - Font::charHeight * 3, Display::Width, Font::charHeight * 2);
+        display.printP("Press to select next  player"_PSTR);
 
-                display.startDraw(0, Display::Height - Font::charHeight, Display::Width, Font::charHeight);
-                display.printP("Hold to confirm"_PSTR);
-            }
-            else if(state.phase == GameState::Phase::GameResults)
-            {
-                showResults(state, display);
-            }
-        }
+        display.startDraw(0, Display::Height - Font::charHeight, Display::Width, Font::charHeight);
+        display.printP("Hold to confirm"_PSTR);
+    }
 
-        if(state.phase == GameState::Phase::GameResults)
-        {
-            if (state.phaseDuration > 4000)
-            {
-                state.advance();
-            }            
-        }
+    void playResults(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        auto& co = state.script;
+        CO_BEGIN(co, state.deltaTime);
 
-        if(state.phase != GameState::Phase::Running)
-        {
-            return;
-        }
+        showResults(state, display);
+        CO_DELAY(co, Tuning::get(TuningId::ResultsDuration));
+
+        state.advance();
+
+        CO_END(co);
+    }
+
+    void updateVote(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& soundController)
+    {
+        auto& data = state.data.voting;
 
         display.selectPlayers(state.playerAlive);
 
@@ -280,6 +273,7 @@ namespace Voting
 
         if(timeLeft < 0 || data.voteDone == state.playerAlive)
         {
+            Statistics::recordVoting(state.phaseDuration);
             computeDeaths(state);
             state.advance();
         }
@@ -332,4 +326,18 @@ namespace Voting
             }
         }
     }
-}
\ No newline at end of file
+
+    PROGMEM const PhaseHandlers phases[GamePhaseCount] =
+    {
+        {.onEnter=startGame},
+        {},
+        {.onEnter=skipDemo},
+        {.onEnter=showInstructions},
+        {},
+        {.onEnter=startVote, .onUpdate=updateVote},
+        {},
+        {.onUpdate=playResults},
+        {},
+        {},
+    };
+}
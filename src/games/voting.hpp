@@ -20,11 +20,11 @@ namespace Voting
         int8_t votingDuration = 30; 
     };
 
-    void update(GameState& state, Display& display, Input& input, LedController& ledController, SoundController& SoundController);
+    extern const PhaseHandlers phases[GamePhaseCount];
 
     constexpr GameDefinition definition
     {
         "Voting"_PSTR,
-        update
+        phases
     };
 }
@@ -2,13 +2,21 @@
 
 #include <stdint.h>
 
+#include "Storage.hpp"
+#include "utils.hpp"
+
 struct Settings
 {
+    // Bump when the layout changes, older records are then ignored
+    static constexpr uint8_t version = 1;
+
     int16_t volume = 20;
 };
 
 inline Settings settings{}; 
 
+inline Storage::RecordRing<Settings, Storage::settingsAddress, Storage::settingsSlots, Settings::version> settingsStorage;
+
 enum class SettingId : uint8_t
 {
     Volume,
@@ -48,4 +56,32 @@ public:
 PROGMEM constexpr SettingDefinition settingDefinitions[] =
 {
     {"Volume"_PSTR, SettingDefinition::Type::Number, {&settings.volume, 0, 30, 5}}
-};
\ No newline at end of file
+};
+
+inline void loadSettings()
+{
+    settingsStorage.load(settings);
+
+    // A valid record from an older build may hold values outside the current ranges
+    for(uint8_t x = 0; x < SettingCount; x++)
+    {
+        const auto definition = readPgm(settingDefinitions[x]);
+        if(definition.type == SettingDefinition::Type::Number)
+        {
+            auto& value = *definition.number.value;
+            if(value < definition.number.min)
+            {
+                value = definition.number.min;
+            }
+            else if(value > definition.number.max)
+            {
+                value = definition.number.max;
+            }
+        }
+    }
+}
+
+inline bool saveSettings()
+{
+    return settingsStorage.save(settings);
+}
\ No newline at end of file
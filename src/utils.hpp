@@ -17,29 +17,6 @@ T readPgm(const T& ptr)
     return readPgm(&ptr);
 }
 
-namespace Random
-{
-    inline auto init()
-    {
-        unsigned long seed = 0;
-        for(uint8_t x = 0; x < sizeof(seed) * 8 / 2; x++)
-        {
-            delay(2);
-            seed |= analogRead(A6) & 0x03;
-            seed <<= 2;
-        }
-
-        randomSeed(seed);
-    
-        return seed;
-    }
-
-    inline bool binary()
-    {
-        return random(0, 2);
-    }
-}
-
 template <typename T, typename Size = uint8_t>
 struct Array
 {
@@ -81,15 +58,6 @@ inline void reverseArray(uint8_t* values, uint8_t count)
     }
 }
 
-inline void shuffle(uint8_t* values, uint8_t count)
-{    
-    for (uint8_t x = count - 1; x > 0; x--) 
-    { 
-        const auto y = random(x + 1);
-        swap(values[x], values[y]); 
-    } 
-}
-
 template<class T> using Invoke = typename T::type;
 
 template<unsigned...> struct seq{ using type = seq; };
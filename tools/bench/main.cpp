@@ -0,0 +1,665 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <elf.h>
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_twi.h>
+#include <simavr/avr_ioport.h>
+
+// Runs the real firmware image under simavr and counts cycles, instruction by instruction.
+//
+//   program firmware.elf scenario.txt... [-f function]... [--symbols]
+//
+// Scenarios are scripts of timed button presses, see tools/bench/scenarios. For each one the
+// bench reports frame cycles per scenario phase, TWI bytes per frame and the inclusive cycles
+// of the tracked functions. Functions inlined into their callers aren't in the image and are
+// reported as such, --symbols lists what is.
+
+namespace
+{
+    constexpr uint32_t frequency = 16000000;
+    constexpr uint32_t cyclesPerMilli = frequency / 1000;
+    constexpr uint32_t tapMillis = 100;
+
+    // App::update only calls it when at least one tick elapsed
+    constexpr const char* frameFunction = "App::runFrame";
+
+    constexpr const char* defaultFunctions[] =
+    {
+        "Input::update",
+        "SoundController::update",
+        "LedController::display",
+        "GameRunner::update",
+        "Display::clearRect",
+        "Display::startDraw",
+        "Display::draw",
+        "Display::print",
+        "Display::printP",
+        "Pong::updateField",
+        "Pong::updateRunning",
+        "Reaction::updateTiming",
+        "Reaction::updatePlayerInputs",
+        "Voting::updateVote",
+    };
+
+    struct Symbol
+    {
+        std::string name;
+        uint32_t address;
+        uint32_t size;
+    };
+
+    // Demangled names of the functions in the image, without "(anonymous namespace)::"
+    std::vector<Symbol> readSymbols(const char* path)
+    {
+        std::vector<Symbol> symbols;
+
+        FILE* file = fopen(path, "rb");
+        if(!file)
+        {
+            return symbols;
+        }
+
+        fseek(file, 0, SEEK_END);
+        std::vector<uint8_t> image(ftell(file));
+        fseek(file, 0, SEEK_SET);
+        const bool read = fread(image.data(), 1, image.size(), file) == image.size();
+        fclose(file);
+
+        if(!read || image.size() < sizeof(Elf32_Ehdr))
+        {
+            return symbols;
+        }
+
+        const auto& header = *reinterpret_cast<const Elf32_Ehdr*>(image.data());
+        const auto* sections = reinterpret_cast<const Elf32_Shdr*>(image.data() + header.e_shoff);
+
+        for(uint16_t x = 0; x < header.e_shnum; x++)
+        {
+            if(sections[x].sh_type != SHT_SYMTAB)
+            {
+                continue;
+            }
+
+            const auto* entries = reinterpret_cast<const Elf32_Sym*>(image.data() + sections[x].sh_offset);
+            const auto* names = reinterpret_cast<const char*>(image.data() + sections[sections[x].sh_link].sh_offset);
+            const auto count = sections[x].sh_size / sizeof(Elf32_Sym);
+
+            for(uint32_t y = 0; y < count; y++)
+            {
+                if(ELF32_ST_TYPE(entries[y].st_info) != STT_FUNC || entries[y].st_value == 0)
+                {
+                    continue;
+                }
+
+                const char* mangled = names + entries[y].st_name;
+
+                int status = 0;
+                char* demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+                std::string name = status == 0 ? demangled : mangled;
+                free(demangled);
+
+                static constexpr char anonymous[] = "(anonymous namespace)::";
+                for(auto found = name.find(anonymous); found != std::string::npos; found = name.find(anonymous))
+                {
+                    name.erase(found, sizeof(anonymous) - 1);
+                }
+
+                symbols.push_back({name, entries[y].st_value, entries[y].st_size});
+            }
+        }
+
+        return symbols;
+    }
+
+    // "Display::draw" matches every overload and clone, not "Display::drawLine"
+    bool matches(const std::string& name, const std::string& function)
+    {
+        if(name.compare(0, function.size(), function) != 0)
+        {
+            return false;
+        }
+
+        return name.size() == function.size() || strchr("(<. ", name[function.size()]);
+    }
+
+    // TCA9548A at 0x70 and the SSD1306 displays behind it at 0x3C, only counts what goes through
+    struct Bus
+    {
+        static constexpr uint8_t muxAddress = 0x70 << 1;
+        static constexpr uint8_t displayAddress = 0x3C << 1;
+
+        enum class Target : uint8_t
+        {
+            None,
+            Mux,
+            Display
+        };
+
+        avr_irq_t* irq = nullptr;
+
+        Target target = Target::None;
+        uint8_t channels = 0;
+        bool control = false;
+        bool continuation = false;
+        bool data = false;
+
+        uint64_t bytes = 0;
+        uint64_t muxBytes = 0;
+        uint64_t commandBytes = 0;
+        uint64_t dataBytes = 0;
+
+        void attach(avr_t* avr)
+        {
+            static const char* names[2] = {"8>bench.twi.out", "32<bench.twi.in"};
+            irq = avr_alloc_irq(&avr->irq_pool, 0, 2, names);
+
+            avr_irq_register_notify(irq + TWI_IRQ_OUTPUT, &Bus::onMessage, this);
+
+            avr_connect_irq(irq + TWI_IRQ_INPUT, avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+            avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), irq + TWI_IRQ_OUTPUT);
+        }
+
+        void ack(uint8_t address)
+        {
+            avr_raise_irq(irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, address, 1));
+        }
+
+        static void onMessage(avr_irq_t*, uint32_t value, void* param)
+        {
+            auto& bus = *static_cast<Bus*>(param);
+
+            avr_twi_msg_irq_t message;
+            message.u.v = value;
+
+            const auto& twi = message.u.twi;
+
+            if(twi.msg & TWI_COND_STOP)
+            {
+                bus.target = Target::None;
+            }
+
+            if(twi.msg & TWI_COND_START)
+            {
+                bus.target = Target::None;
+                bus.control = true;
+                bus.continuation = false;
+
+                if(twi.addr == muxAddress)
+                {
+                    bus.target = Target::Mux;
+                }
+                else if(twi.addr == displayAddress && bus.channels)
+                {
+                    bus.target = Target::Display;
+                }
+
+                if(bus.target != Target::None)
+                {
+                    bus.bytes++;
+                    bus.ack(twi.addr);
+                }
+            }
+
+            if(bus.target == Target::None || !(twi.msg & TWI_COND_WRITE))
+            {
+                return;
+            }
+
+            bus.bytes++;
+            bus.ack(twi.addr);
+
+            if(bus.target == Target::Mux)
+            {
+                bus.channels = twi.data;
+                bus.muxBytes++;
+            }
+            else if(bus.control)
+            {
+                // With the Co bit set another control byte follows the next byte, clear the
+                // rest of the transfer is commands or data
+                bus.data = twi.data & 0x40;
+                bus.continuation = twi.data & 0x80;
+                bus.control = false;
+                bus.commandBytes++;
+            }
+            else
+            {
+                (bus.data ? bus.dataBytes : bus.commandBytes)++;
+                bus.control = bus.continuation;
+            }
+        }
+    };
+
+    // Handles on PB0, PB2, PB4, PD6 are active high, the menu buttons on PC1-PC3 active low
+    struct Buttons
+    {
+        struct Pin
+        {
+            char port;
+            uint8_t bit;
+            bool activeLow;
+        };
+
+        static constexpr Pin pins[] =
+        {
+            {'B', 0, false},
+            {'B', 2, false},
+            {'B', 4, false},
+            {'D', 6, false},
+            {'C', 1, true},
+            {'C', 2, true},
+            {'C', 3, true},
+        };
+
+        static constexpr uint8_t count = sizeof(pins) / sizeof(pins[0]);
+
+        avr_t* avr = nullptr;
+
+        static int8_t index(char button)
+        {
+            if(button >= '0' && button <= '3')
+            {
+                return button - '0';
+            }
+
+            const char* menu = strchr("usd", button);
+            return menu && button ? 4 + (menu - "usd") : -1;
+        }
+
+        void set(uint8_t index, bool pressed)
+        {
+            const auto& pin = pins[index];
+            avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(pin.port), pin.bit), pressed != pin.activeLow);
+        }
+
+        void attach(avr_t* avr)
+        {
+            this->avr = avr;
+            for(uint8_t x = 0; x < count; x++)
+            {
+                set(x, false);
+            }
+        }
+    };
+
+    // One line per step, "<ms> <action> [argument]", # starts a comment:
+    //   tap <button>      press for 100ms, buttons are 0-3 for the handles and u, s, d for the menu
+    //   press <button>    hold until released
+    //   release <button>
+    //   mark <phase>      frames from here on are reported under that phase
+    //   end               stops the scenario
+    struct Step
+    {
+        enum class Action : uint8_t
+        {
+            Press,
+            Release,
+            Mark,
+            End
+        };
+
+        uint32_t at;
+        Action action;
+        int8_t button;
+        std::string label;
+    };
+
+    bool readScenario(const char* path, std::vector<Step>& steps)
+    {
+        FILE* file = fopen(path, "r");
+        if(!file)
+        {
+            fprintf(stderr, "can't open %s\n", path);
+            return false;
+        }
+
+        char line[256];
+        uint16_t number = 0;
+        bool valid = true;
+
+        while(fgets(line, sizeof(line), file))
+        {
+            number++;
+
+            if(char* comment = strchr(line, '#'))
+            {
+                *comment = '\0';
+            }
+
+            unsigned long at = 0;
+            char action[16] = {};
+            char argument[64] = {};
+
+            const int fields = sscanf(line, "%lu %15s %63s", &at, action, argument);
+            if(fields <= 0)
+            {
+                continue;
+            }
+
+            const auto button = Buttons::index(argument[0]);
+
+            if(fields == 2 && strcmp(action, "end") == 0)
+            {
+                steps.push_back({static_cast<uint32_t>(at), Step::Action::End, -1, {}});
+            }
+            else if(fields == 3 && strcmp(action, "mark") == 0)
+            {
+                steps.push_back({static_cast<uint32_t>(at), Step::Action::Mark, -1, argument});
+            }
+            else if(fields == 3 && button >= 0 && argument[1] == '\0' && strcmp(action, "tap") == 0)
+            {
+                steps.push_back({static_cast<uint32_t>(at), Step::Action::Press, button, {}});
+                steps.push_back({static_cast<uint32_t>(at + tapMillis), Step::Action::Release, button, {}});
+            }
+            else if(fields == 3 && button >= 0 && argument[1] == '\0' && strcmp(action, "press") == 0)
+            {
+                steps.push_back({static_cast<uint32_t>(at), Step::Action::Press, button, {}});
+            }
+            else if(fields == 3 && button >= 0 && argument[1] == '\0' && strcmp(action, "release") == 0)
+            {
+                steps.push_back({static_cast<uint32_t>(at), Step::Action::Release, button, {}});
+            }
+            else
+            {
+                fprintf(stderr, "%s:%u: can't parse step\n", path, number);
+                valid = false;
+            }
+        }
+
+        fclose(file);
+
+        // Stable, so a release and a press at the same time stay in script order
+        std::stable_sort(steps.begin(), steps.end(), [](const Step& a, const Step& b) { return a.at < b.at; });
+
+        return valid;
+    }
+
+    struct Summary
+    {
+        uint64_t count = 0;
+        uint64_t min = UINT64_MAX;
+        uint64_t max = 0;
+        uint64_t total = 0;
+
+        void add(uint64_t value)
+        {
+            count++;
+            total += value;
+            min = value < min ? value : min;
+            max = value > max ? value : max;
+        }
+
+        uint64_t average() const
+        {
+            return count ? total / count : 0;
+        }
+    };
+
+    struct Tracked
+    {
+        std::string name;
+        bool found = false;
+        Summary calls;
+    };
+
+    struct PhaseFrames
+    {
+        std::string label;
+        Summary cycles;
+        Summary bytes;
+    };
+
+    struct Frame
+    {
+        uint16_t tracked;
+        uint16_t sp;
+        uint64_t start;
+        uint64_t bytes;
+    };
+
+    uint16_t readSp(const avr_t* avr)
+    {
+        return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+    }
+
+    bool runScenario(const char* elf, const char* path, const std::vector<Symbol>& symbols, const std::vector<std::string>& functions)
+    {
+        std::vector<Step> steps;
+        if(!readScenario(path, steps))
+        {
+            return false;
+        }
+
+        elf_firmware_t firmware = {};
+        if(elf_read_firmware(elf, &firmware) != 0)
+        {
+            fprintf(stderr, "can't load %s\n", elf);
+            return false;
+        }
+
+        avr_t* avr = avr_make_mcu_by_name("atmega328p");
+        if(!avr)
+        {
+            fprintf(stderr, "simavr has no atmega328p core\n");
+            return false;
+        }
+
+        avr_init(avr);
+        avr->frequency = frequency;
+        avr_load_firmware(avr, &firmware);
+
+        Bus bus;
+        bus.attach(avr);
+
+        Buttons buttons;
+        buttons.attach(avr);
+
+        // The frame function comes first, the others after it in the order given
+        std::vector<Tracked> tracked;
+        tracked.push_back({frameFunction});
+        for(const auto& function : functions)
+        {
+            tracked.push_back({function});
+        }
+
+        std::unordered_map<uint32_t, uint16_t> entries;
+        for(uint16_t x = 0; x < tracked.size(); x++)
+        {
+            for(const auto& symbol : symbols)
+            {
+                if(matches(symbol.name, tracked[x].name))
+                {
+                    entries.emplace(symbol.address, x);
+                    tracked[x].found = true;
+                }
+            }
+        }
+
+        if(!tracked[0].found)
+        {
+            fprintf(stderr, "%s isn't in %s\n", frameFunction, elf);
+            return false;
+        }
+
+        std::vector<PhaseFrames> phases = {{"boot"}};
+        std::vector<Frame> stack;
+
+        size_t next = 0;
+        uint64_t end = UINT64_MAX;
+        int state = cpu_Running;
+
+        while(state != cpu_Done && state != cpu_Crashed && avr->cycle < end)
+        {
+            for(; next < steps.size() && avr->cycle >= static_cast<uint64_t>(steps[next].at) * cyclesPerMilli; next++)
+            {
+                const auto& step = steps[next];
+                switch(step.action)
+                {
+                case Step::Action::Press:
+                case Step::Action::Release:
+                    buttons.set(step.button, step.action == Step::Action::Press);
+                    break;
+                case Step::Action::Mark:
+                    phases.push_back({step.label});
+                    break;
+                case Step::Action::End:
+                    end = avr->cycle;
+                    break;
+                }
+            }
+
+            state = avr_run(avr);
+
+            // Returned once the stack is back above where it was at the call
+            const auto sp = readSp(avr);
+            while(!stack.empty() && sp > stack.back().sp)
+            {
+                const auto& frame = stack.back();
+                const auto cycles = avr->cycle - frame.start;
+
+                tracked[frame.tracked].calls.add(cycles);
+                if(frame.tracked == 0)
+                {
+                    phases.back().cycles.add(cycles);
+                    phases.back().bytes.add(bus.bytes - frame.bytes);
+                }
+
+                stack.pop_back();
+            }
+
+            const auto entry = entries.find(avr->pc);
+            if(entry == entries.end())
+            {
+                continue;
+            }
+
+            // A loop back to the first instruction isn't a new call
+            if(!stack.empty() && stack.back().tracked == entry->second && stack.back().sp == sp)
+            {
+                continue;
+            }
+
+            stack.push_back({entry->second, sp, avr->cycle, bus.bytes});
+        }
+
+        const uint64_t millis = avr->cycle / cyclesPerMilli;
+
+        printf("scenario %s\n", path);
+        printf("  time %llums, %llu cycles%s\n", static_cast<unsigned long long>(millis),
+            static_cast<unsigned long long>(avr->cycle), state == cpu_Crashed ? ", crashed" : "");
+        printf("  twi bytes %llu (mux %llu, commands %llu, data %llu), %llu per second\n",
+            static_cast<unsigned long long>(bus.bytes), static_cast<unsigned long long>(bus.muxBytes),
+            static_cast<unsigned long long>(bus.commandBytes), static_cast<unsigned long long>(bus.dataBytes),
+            static_cast<unsigned long long>(millis ? bus.bytes * 1000 / millis : 0));
+
+        printf("  %-16s %8s %10s %10s %10s %10s %10s\n", "phase", "frames", "min", "avg", "max", "bytes avg", "bytes max");
+        for(const auto& phase : phases)
+        {
+            if(phase.cycles.count == 0)
+            {
+                continue;
+            }
+
+            printf("  %-16s %8llu %10llu %10llu %10llu %10llu %10llu\n", phase.label.c_str(),
+                static_cast<unsigned long long>(phase.cycles.count), static_cast<unsigned long long>(phase.cycles.min),
+                static_cast<unsigned long long>(phase.cycles.average()), static_cast<unsigned long long>(phase.cycles.max),
+                static_cast<unsigned long long>(phase.bytes.average()), static_cast<unsigned long long>(phase.bytes.max));
+        }
+
+        printf("  %-30s %8s %12s %10s %10s %7s\n", "function", "calls", "cycles", "avg", "max", "share");
+        for(uint16_t x = 1; x < tracked.size(); x++)
+        {
+            const auto& function = tracked[x];
+            if(!function.found)
+            {
+                printf("  %-30s not in the image, inlined or renamed\n", function.name.c_str());
+                continue;
+            }
+
+            printf("  %-30s %8llu %12llu %10llu %10llu %6.2f%%\n", function.name.c_str(),
+                static_cast<unsigned long long>(function.calls.count), static_cast<unsigned long long>(function.calls.total),
+                static_cast<unsigned long long>(function.calls.average()), static_cast<unsigned long long>(function.calls.max),
+                avr->cycle ? function.calls.total * 100.0 / avr->cycle : 0.0);
+        }
+
+        printf("\n");
+        avr_terminate(avr);
+
+        return state != cpu_Crashed;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* elf = nullptr;
+    std::vector<const char*> scenarios;
+    std::vector<std::string> functions;
+    bool listSymbols = false;
+
+    for(int x = 1; x < argc; x++)
+    {
+        if(strcmp(argv[x], "-f") == 0 && x + 1 < argc)
+        {
+            functions.push_back(argv[++x]);
+        }
+        else if(strcmp(argv[x], "--symbols") == 0)
+        {
+            listSymbols = true;
+        }
+        else if(!elf)
+        {
+            elf = argv[x];
+        }
+        else
+        {
+            scenarios.push_back(argv[x]);
+        }
+    }
+
+    if(!elf || (scenarios.empty() && !listSymbols))
+    {
+        fprintf(stderr, "usage: %s firmware.elf scenario.txt... [-f function]... [--symbols]\n", argv[0]);
+        return 2;
+    }
+
+    const auto symbols = readSymbols(elf);
+    if(symbols.empty())
+    {
+        fprintf(stderr, "no function symbols in %s\n", elf);
+        return 1;
+    }
+
+    if(listSymbols)
+    {
+        for(const auto& symbol : symbols)
+        {
+            printf("%06x %6u %s\n", symbol.address, symbol.size, symbol.name.c_str());
+        }
+    }
+
+    if(functions.empty())
+    {
+        functions.assign(std::begin(defaultFunctions), std::end(defaultFunctions));
+    }
+
+    bool passed = true;
+    for(const auto* scenario : scenarios)
+    {
+        passed &= runScenario(elf, scenario, symbols, functions);
+    }
+
+    return passed ? 0 : 1;
+}
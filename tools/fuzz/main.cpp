@@ -0,0 +1,443 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "Host.hpp"
+#include "Session.hpp"
+
+// Searches button scripts for the worst frames of the native build: the longest single pass
+// through loop() and the most bus bytes sent in one.
+//
+//   program [iterations] [--seconds N] [--seed N] [--out dir]
+//
+// Scripts start from random sessions (joins, menu navigation, games with simultaneous presses,
+// long presses and pauses) and the worst ones found are mutated further. Each run gets its own
+// process, the firmware state can't be reset. The worst script per objective is saved to the
+// out directory (.pio/fuzz by default) whenever it gets worse, replay one with
+//   program --script .pio/fuzz/longest-frame.txt
+// Worth keeping ones go to tools/fuzz/scenarios with --max-frame-us or --max-frame-bytes bounds,
+// the native program fails a script that goes over them.
+// Runs that hang or crash are saved as hang-N.txt and crash-N.txt.
+
+namespace
+{
+    constexpr uint8_t poolSize = 8;
+    constexpr unsigned timeoutSeconds = 20;
+
+    constexpr char handles[] = "0123";
+    constexpr char menuButtons[] = "usd";
+
+    struct Rng
+    {
+        uint32_t state;
+
+        uint32_t next()
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+
+        uint32_t below(uint32_t bound)
+        {
+            return bound ? next() % bound : 0;
+        }
+
+        uint32_t between(uint32_t low, uint32_t high)
+        {
+            return low + below(high - low + 1);
+        }
+
+        bool chance(uint8_t percent)
+        {
+            return below(100) < percent;
+        }
+    };
+
+    Rng rng{0x2545F491};
+
+    enum class Objective : uint8_t
+    {
+        LongestFrame,
+        FrameBytes,
+
+        Count
+    };
+
+    constexpr uint8_t objectiveCount = static_cast<uint8_t>(Objective::Count);
+    constexpr const char* objectiveNames[objectiveCount] = {"longest-frame", "frame-bytes"};
+
+    uint32_t score(const Session::Result& result, Objective objective)
+    {
+        return objective == Objective::LongestFrame ? result.longestFrame : result.mostFrameBytes;
+    }
+
+    struct Candidate
+    {
+        Session::Script script;
+        Session::Result result;
+        bool valid = false;
+    };
+
+    bool press(Session::Script& script, uint32_t at, char button, uint16_t duration = Session::defaultPress)
+    {
+        if(script.pressCount == Session::maxPresses || at >= script.duration)
+        {
+            return false;
+        }
+
+        script.presses[script.pressCount++] = {at, button, duration};
+        return true;
+    }
+
+    char randomHandle()
+    {
+        return handles[rng.below(4)];
+    }
+
+    // One thing a player could do at that time, returns when it ends
+    uint32_t addEvent(Session::Script& script, uint32_t at)
+    {
+        switch(rng.below(6))
+        {
+        case 0:
+            press(script, at, randomHandle(), rng.between(20, 300));
+            return at + rng.between(50, 800);
+
+        case 1:
+        {
+            // Several handles in the same millisecond
+            const uint8_t mask = rng.between(3, 15);
+            for(uint8_t x = 0; x < 4; x++)
+            {
+                if(mask & (1 << x))
+                {
+                    press(script, at, handles[x], rng.between(20, 300));
+                }
+            }
+            return at + rng.between(50, 800);
+        }
+
+        case 2:
+        {
+            const char button = rng.chance(50) ? randomHandle() : menuButtons[rng.below(3)];
+            const uint16_t duration = rng.between(900, 2000);
+            press(script, at, button, duration);
+            return at + duration;
+        }
+
+        case 3:
+        {
+            // Pause, then resume or leave the game
+            press(script, at, 's');
+            at += rng.between(150, 3000);
+            if(rng.chance(70))
+            {
+                press(script, at, 's');
+            }
+            else
+            {
+                press(script, at, 'd');
+                press(script, at + 300, 's');
+            }
+            return at + 300;
+        }
+
+        case 4:
+            press(script, at, menuButtons[rng.below(3)]);
+            return at + rng.between(150, 1000);
+
+        default:
+            return at + rng.between(200, 3000);
+        }
+    }
+
+    Session::Script generate(uint32_t duration)
+    {
+        Session::Script script;
+        script.duration = duration;
+        script.seed = rng.next() | 1;
+
+        // Joins, staggered or all at once, confirmed from the menu unless the box is full
+        uint32_t at = rng.between(200, 1500);
+        const bool together = rng.chance(30);
+        const uint8_t joined = rng.between(1, 15);
+        uint8_t players = 0;
+        for(uint8_t x = 0; x < 4; x++)
+        {
+            if(joined & (1 << x))
+            {
+                press(script, at, handles[x]);
+                at += together ? 0 : rng.between(110, 600);
+                players++;
+            }
+        }
+
+        at += rng.between(200, 800);
+        if(players < 4)
+        {
+            press(script, at, 's');
+            at += rng.between(300, 900);
+        }
+
+        // Through the menus, then ready up
+        for(uint8_t x = rng.between(1, 6); x > 0; x--)
+        {
+            press(script, at, menuButtons[rng.below(3)]);
+            at += rng.between(200, 900);
+        }
+
+        at += rng.between(1000, 4000);
+        for(uint8_t x = 0; x < 4; x++)
+        {
+            if(joined & (1 << x))
+            {
+                press(script, at, handles[x]);
+            }
+        }
+
+        while(at < script.duration && script.pressCount < Session::maxPresses)
+        {
+            at = addEvent(script, at + rng.between(0, 500));
+        }
+
+        return script;
+    }
+
+    void removePress(Session::Script& script, uint8_t index)
+    {
+        script.presses[index] = script.presses[--script.pressCount];
+    }
+
+    Session::Script mutate(const Session::Script& parent)
+    {
+        auto script = parent;
+
+        for(uint8_t count = rng.between(1, 3); count > 0; count--)
+        {
+            const uint8_t index = rng.below(script.pressCount);
+            auto& target = script.presses[index];
+
+            switch(script.pressCount ? rng.below(7) : 4)
+            {
+            case 0:
+            {
+                const int32_t shift = static_cast<int32_t>(rng.below(4001)) - 2000;
+                const int32_t moved = static_cast<int32_t>(target.at) + shift;
+                target.at = moved < 0 ? 0 : (moved >= static_cast<int32_t>(script.duration) ? script.duration - 1 : moved);
+                break;
+            }
+            case 1:
+                target.button = rng.chance(60) ? randomHandle() : menuButtons[rng.below(3)];
+                break;
+            case 2:
+                target.duration = rng.chance(70) ? rng.between(20, 400) : rng.between(900, 2000);
+                break;
+            case 3:
+                removePress(script, index);
+                break;
+            case 4:
+                addEvent(script, rng.below(script.duration));
+                break;
+            case 5:
+                // Another handle in the same millisecond
+                press(script, target.at, randomHandle(), target.duration);
+                break;
+            default:
+                script.seed = rng.next() | 1;
+                break;
+            }
+        }
+
+        return script;
+    }
+
+    enum class Outcome : uint8_t
+    {
+        Finished,
+        Hung,
+        Crashed
+    };
+
+    // In a child process, the firmware only boots once per process
+    Outcome evaluate(const Session::Script& script, Session::Result& result)
+    {
+        int pipes[2];
+        if(pipe(pipes) != 0)
+        {
+            perror("pipe");
+            exit(1);
+        }
+
+        fflush(stdout);
+
+        const pid_t child = fork();
+        if(child == 0)
+        {
+            close(pipes[0]);
+
+            // Whatever the firmware prints would only get in the way
+            freopen("/dev/null", "w", stdout);
+            alarm(timeoutSeconds);
+
+            const auto childResult = Session::run(script);
+            const bool written = write(pipes[1], &childResult, sizeof(childResult)) == sizeof(childResult);
+            _exit(written ? 0 : 1);
+        }
+
+        close(pipes[1]);
+
+        const bool received = read(pipes[0], &result, sizeof(result)) == sizeof(result);
+        close(pipes[0]);
+
+        int status = 0;
+        waitpid(child, &status, 0);
+
+        if(WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM)
+        {
+            return Outcome::Hung;
+        }
+
+        return received && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? Outcome::Finished : Outcome::Crashed;
+    }
+
+    void save(const char* directory, const char* name, const Session::Script& script, const char* description)
+    {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s.txt", directory, name);
+
+        FILE* file = fopen(path, "w");
+        if(!file)
+        {
+            fprintf(stderr, "can't write %s\n", path);
+            return;
+        }
+
+        fprintf(file, "# %s, found by tools/fuzz\n", description);
+        Session::save(script, file);
+        fclose(file);
+    }
+
+    // Keeps the pool sorted worst first, returns true when the candidate became the worst
+    bool insert(Candidate (&pool)[poolSize], const Candidate& candidate, Objective objective)
+    {
+        const auto value = score(candidate.result, objective);
+
+        uint8_t position = poolSize;
+        while(position > 0 && (!pool[position - 1].valid || score(pool[position - 1].result, objective) < value))
+        {
+            position--;
+        }
+
+        if(position == poolSize)
+        {
+            return false;
+        }
+
+        for(uint8_t x = poolSize - 1; x > position; x--)
+        {
+            pool[x] = pool[x - 1];
+        }
+        pool[position] = candidate;
+
+        return position == 0;
+    }
+
+    uint8_t poolCount(const Candidate (&pool)[poolSize])
+    {
+        uint8_t count = 0;
+        while(count < poolSize && pool[count].valid)
+        {
+            count++;
+        }
+
+        return count;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = 2000;
+    uint32_t seconds = 30;
+    const char* directory = ".pio/fuzz";
+
+    for(int x = 1; x < argc; x++)
+    {
+        if(strcmp(argv[x], "--seconds") == 0 && x + 1 < argc)
+        {
+            seconds = strtoul(argv[++x], nullptr, 10);
+        }
+        else if(strcmp(argv[x], "--seed") == 0 && x + 1 < argc)
+        {
+            rng.state = strtoul(argv[++x], nullptr, 10) | 1;
+        }
+        else if(strcmp(argv[x], "--out") == 0 && x + 1 < argc)
+        {
+            directory = argv[++x];
+        }
+        else
+        {
+            iterations = strtoul(argv[x], nullptr, 10);
+        }
+    }
+
+    mkdir(directory, 0755);
+
+    Candidate pools[objectiveCount][poolSize] = {};
+    uint32_t failures = 0;
+
+    for(uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        // Mostly mutations of the worst scripts so far, some fresh ones to keep exploring
+        const auto objective = static_cast<Objective>(iteration % objectiveCount);
+        auto& pool = pools[static_cast<uint8_t>(objective)];
+        const auto count = poolCount(pool);
+
+        Candidate candidate;
+        candidate.script = count > 0 && rng.chance(80) ? mutate(pool[rng.below(count)].script) : generate(seconds * 1000);
+
+        const auto outcome = evaluate(candidate.script, candidate.result);
+        if(outcome != Outcome::Finished)
+        {
+            char name[32];
+            const bool hung = outcome == Outcome::Hung;
+            snprintf(name, sizeof(name), "%s-%u", hung ? "hang" : "crash", failures++);
+            save(directory, name, candidate.script, hung ? "never returned" : "crashed");
+            printf("%6u %s, saved as %s\n", iteration, hung ? "hang" : "crash", name);
+            continue;
+        }
+
+        candidate.valid = true;
+
+        for(uint8_t x = 0; x < objectiveCount; x++)
+        {
+            const auto target = static_cast<Objective>(x);
+            if(!insert(pools[x], candidate, target))
+            {
+                continue;
+            }
+
+            const auto& result = candidate.result;
+
+            char description[128];
+            if(target == Objective::LongestFrame)
+            {
+                snprintf(description, sizeof(description), "longest frame %uus at %ums", result.longestFrame, result.longestFrameAt);
+            }
+            else
+            {
+                snprintf(description, sizeof(description), "%u bus bytes in one frame at %ums", result.mostFrameBytes, result.mostFrameBytesAt);
+            }
+
+            save(directory, objectiveNames[x], candidate.script, description);
+            printf("%6u %s: %s\n", iteration, objectiveNames[x], description);
+        }
+    }
+
+    return 0;
+}